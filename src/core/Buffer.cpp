@@ -4,29 +4,37 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 -*/
 #include "Buffer.h"
 
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-BaseBuffer::TargetBufferMap BaseBuffer::s_boundBufferToTarget;
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+/// Creates names of buffers deferred by the constructor
+static void CreateBuffers(GLenum, GLsizei n, GLuint* names)
+{
+#ifdef GLFK_BATCH_GL_NAMES
+    for (GLsizei i=0; i<n; i++) {
+        names[i] = GLStateCache::Current().GetNamePool().GenBuffer();
+    }
+#else
+    if (Renderer::HasDirectStateAccess()) {
+        glCreateBuffers(n, names);
+    } else {
+        glGenBuffers(n, names);
+    }
 #endif
+}
 
 BaseBuffer::BaseBuffer(VertexArray vao)
 : _vao(vao)
 {
-    GLFK_AUTO_BIND_OBJ(vao);
-    
-    GLuint buffer;
-    glGenBuffers(1, &buffer);
-    
-    AssignGLObject(buffer, glDeleteBuffers);
-    
-    GLFK_AUTO_UNBIND_OBJ(vao);
+    DeferGLObject(CreateBuffers, 0, glDeleteBuffers);
 }
 
 BaseBuffer& BaseBuffer::Bind(GLenum target) 
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundBufferToTarget[target] == *this)
+    if (!GLStateCache::Current().SetBuffer(target, *this))
         return *this;
-    s_boundBufferToTarget[target] = *this;
 #endif
     glBindBuffer(target, *this);
     return *this;
@@ -34,26 +42,251 @@ BaseBuffer& BaseBuffer::Bind(GLenum target)
 void BaseBuffer::BindNone(GLenum target)
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundBufferToTarget[target] == 0)
+    if (!GLStateCache::Current().SetBuffer(target, 0))
         return;
-    s_boundBufferToTarget[target] = 0;
 #endif
     glBindBuffer(target, 0);
 }
 
+BaseBuffer& BaseBuffer::BindBase(GLenum target, GLuint index)
+{
+#ifdef GLFK_PREVENT_MULTIPLE_BIND
+    GLStateCache::Current().SetBuffer(target, *this); // binds the generic target as well
+#endif
+    glBindBufferBase(target, index, *this);
+    return *this;
+}
+
+BaseBuffer& BaseBuffer::BindRange(GLenum target, GLuint index, GLintptr offset, GLsizeiptr size)
+{
+#ifdef GLFK_PREVENT_MULTIPLE_BIND
+    GLStateCache::Current().SetBuffer(target, *this); // binds the generic target as well
+#endif
+    glBindBufferRange(target, index, *this, offset, size);
+    return *this;
+}
+
+BaseBuffer::BufferData* BaseBuffer::GetBufferData()
+{
+    BufferData* data = (BufferData*)GetSharedData();
+    if (!data) {
+        data = new BufferData;
+        SetSharedData(data);
+    }
+    return data;
+}
+
 BaseBuffer& BaseBuffer::SetData(GLenum target, GLsizeiptr size, const GLvoid * data, BufferUsage::E usage)
 {
+    BufferData* bufferData = GetBufferData();
+    bufferData->size = size;
+    bufferData->usage = usage;
+    bufferData->dirty.clear();
+    
+    if (Renderer::HasDirectStateAccess()) {
+        glNamedBufferData(*this, size, data, usage);
+        if (target == GL_ELEMENT_ARRAY_BUFFER) {
+            // bind path attaches the index buffer to the VAO by binding it, do the same explicitly
+            glVertexArrayElementBuffer(_vao, *this);
+#ifdef GLFK_PREVENT_MULTIPLE_BIND
+            GLStateCache::Current().ForgetBuffer(GL_ELEMENT_ARRAY_BUFFER);
+#endif
+        }
+        return *this;
+    }
+    
+    // binding attaches the index buffer to the bound VAO, make sure it's the one of this buffer
+    bool elements = target == GL_ELEMENT_ARRAY_BUFFER;
+    if (elements) {
+        GLFK_AUTO_BIND_OBJ(_vao);
+    }
     GLFK_AUTO_BIND(target);
     glBufferData(target, size, data, usage);
+    if (elements) {
+        // unbinding the index buffer would detach it from the VAO
+        GLFK_AUTO_UNBIND_OBJ(_vao);
+    } else {
+        GLFK_AUTO_UNBIND(target);
+    }
+    return *this;
+}
+
+BaseBuffer& BaseBuffer::SetSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid * data)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        glNamedBufferSubData(*this, offset, size, data);
+        return *this;
+    }
+    
+    GLFK_AUTO_BIND(target);
+    glBufferSubData(target, offset, size, data);
     GLFK_AUTO_UNBIND(target);
     return *this;
 }
 
+BaseBuffer& BaseBuffer::Orphan(GLenum target)
+{
+    BufferData* data = GetBufferData();
+    assert(data->size > 0); // SetData wasn't called, size of the storage is unknown
+    
+    if (Renderer::HasDirectStateAccess()) {
+        glNamedBufferData(*this, data->size, NULL, data->usage);
+        return *this;
+    }
+    
+    GLFK_AUTO_BIND(target);
+    glBufferData(target, data->size, NULL, data->usage);
+    GLFK_AUTO_UNBIND(target);
+    return *this;
+}
+
+void* BaseBuffer::MapRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        return glMapNamedBufferRange(*this, offset, length, access);
+    }
+    
+    // the buffer must stay bound to the target until Unmap
+    Bind(target);
+    return glMapBufferRange(target, offset, length, access);
+}
+
+BaseBuffer& BaseBuffer::FlushMappedRange(GLenum target, GLintptr offset, GLsizeiptr length)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        glFlushMappedNamedBufferRange(*this, offset, length);
+        return *this;
+    }
+    
+    GLFK_AUTO_BIND(target);
+    glFlushMappedBufferRange(target, offset, length);
+    return *this;
+}
+
+bool BaseBuffer::Unmap(GLenum target)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        return glUnmapNamedBuffer(*this) == GL_TRUE;
+    }
+    
+    GLFK_AUTO_BIND(target);
+    bool ok = glUnmapBuffer(target) == GL_TRUE;
+    GLFK_AUTO_UNBIND(target);
+    return ok;
+}
+
+BaseBuffer& BaseBuffer::WriteSubData(GLintptr offset, GLsizeiptr size, const GLvoid * data)
+{
+    BufferData* bufferData = GetBufferData();
+    std::vector<unsigned char>& shadow = bufferData->shadow;
+    std::vector<ByteRange>& dirty = bufferData->dirty;
+    
+    // a range past the storage would fail the whole coalesced upload
+    assert(offset >= 0 && size >= 0 && offset + size <= bufferData->size);
+    if (offset < 0 || size < 0 || offset + size > bufferData->size) {
+        printf("%s: range %ld+%ld is out of the buffer of %ld bytes!\n", __FUNCTION__, (long)offset, (long)size,
+               (long)bufferData->size);
+        return *this;
+    }
+    
+    if (shadow.size() < (size_t)(offset + size)) {
+        shadow.resize(offset + size);
+    }
+    memcpy(&shadow[offset], data, size);
+    
+    // insert the range keeping the list sorted, merging touching and overlapping ranges
+    ByteRange range = { offset, offset + size };
+    size_t i = 0;
+    while (i < dirty.size() && dirty[i].end < range.begin) {
+        ++i;
+    }
+    size_t j = i;
+    while (j < dirty.size() && dirty[j].begin <= range.end) {
+        range.begin = std::min(range.begin, dirty[j].begin);
+        range.end = std::max(range.end, dirty[j].end);
+        ++j;
+    }
+    dirty.erase(dirty.begin() + i, dirty.begin() + j);
+    dirty.insert(dirty.begin() + i, range);
+    
+    if (dirty.size() > GLFK_MAX_DIRTY_RANGES) {
+        // gaps between the ranges don't have valid shadow data, upload rather than merge them.
+        // Copy target doesn't touch element array binding of the bound VAO.
+        FlushSubData(GL_COPY_WRITE_BUFFER);
+    }
+    return *this;
+}
+
+BaseBuffer& BaseBuffer::FlushSubData(GLenum target)
+{
+    BufferData* data = GetBufferData();
+    if (data->dirty.empty()) {
+        return *this;
+    }
+    
+    if (Renderer::HasDirectStateAccess()) {
+        for (size_t i = 0; i < data->dirty.size(); ++i) {
+            const ByteRange& r = data->dirty[i];
+            glNamedBufferSubData(*this, r.begin, r.end - r.begin, &data->shadow[r.begin]);
+        }
+    } else {
+        GLFK_AUTO_BIND(target);
+        for (size_t i = 0; i < data->dirty.size(); ++i) {
+            const ByteRange& r = data->dirty[i];
+            glBufferSubData(target, r.begin, r.end - r.begin, &data->shadow[r.begin]);
+        }
+        GLFK_AUTO_UNBIND(target);
+    }
+    data->dirty.clear();
+    return *this;
+}
+
+unsigned BaseBuffer::GetDirtyRangeCount()const
+{
+    BufferData* data = (BufferData*)GetSharedData();
+    return data ? data->dirty.size() : 0;
+}
+
 //-----------------------------------------------------------------------
 
+/// Returns size of one vertex attribute in bytes as used by tightly packed arrays (stride 0)
+static GLsizei AttribSize(GLint size, AttribType::E type)
+{
+    switch (type) {
+        case AttribType::BYTE:
+        case AttribType::UNSIGNED_BYTE:
+            return size;
+        case AttribType::SHORT:
+        case AttribType::UNSIGNED_SHORT:
+        case AttribType::HALF_FLOAT:
+            return size * 2;
+        case AttribType::DOUBLE:
+            return size * 8;
+        case AttribType::INT_2_10_10_10_REV:
+        case AttribType::UNSIGNED_INT_2_10_10_10_REV:
+        case AttribType::UNSIGNED_INT_10F_11F_11F_REV:
+            return 4; // all components packed in one 32-bit word
+        default:
+            return size * 4;
+    }
+}
+
 ArrayBuffer& ArrayBuffer::SetAttribPointer(GLuint index, GLint size, AttribType::E type,
                                 bool normalized, GLsizei stride, const GLvoid * pointer)
 {
+    if (Renderer::HasDirectStateAccess()) {
+        // each attribute gets its own binding point with the same index;
+        // DSA takes the pointer as a buffer offset and needs an explicit stride
+        if (stride == 0) {
+            stride = AttribSize(size, type);
+        }
+        glVertexArrayVertexBuffer(_vao, index, *this, (GLintptr)pointer, stride);
+        glVertexArrayAttribFormat(_vao, index, size, type, normalized, 0);
+        glVertexArrayAttribBinding(_vao, index, index);
+        _vao.EnableAttribArray(index);
+        return *this;
+    }
+    
     GLFK_AUTO_BIND();
     _vao.EnableAttribArray(index);
     glVertexAttribPointer(index, size, type, normalized, stride, pointer);
@@ -62,3 +295,138 @@ ArrayBuffer& ArrayBuffer::SetAttribPointer(GLuint index, GLint size, AttribType:
 }
 
 
+
+//-----------------------------------------------------------------------
+
+StreamBuffer::StreamData::~StreamData()
+{
+    for (unsigned i = 0; i < fences.size(); ++i) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+        }
+    }
+}
+
+StreamBuffer::StreamBuffer(VertexArray vao, GLenum target, GLsizeiptr regionSize, unsigned regions)
+: Buffer(vao, target)
+{
+    StreamData* data = new StreamData;
+    data->regionSize = regionSize;
+    data->fences.resize(regions, (GLsync)0);
+    data->persistent = Renderer::HasBufferStorage();
+    SetSharedData(data);
+    
+    GLsizeiptr size = regionSize * regions;
+    if (!data->persistent) {
+        SetData(size, NULL, BufferUsage::STREAM_DRAW);
+        return;
+    }
+    
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    if (Renderer::HasDirectStateAccess()) {
+        glNamedBufferStorage(*this, size, NULL, flags);
+        data->mapped = (unsigned char*)glMapNamedBufferRange(*this, 0, size, flags);
+        if (_target == GL_ELEMENT_ARRAY_BUFFER) {
+            glVertexArrayElementBuffer(_vao, *this);
+#ifdef GLFK_PREVENT_MULTIPLE_BIND
+            GLStateCache::Current().ForgetBuffer(GL_ELEMENT_ARRAY_BUFFER);
+#endif
+        }
+        return;
+    }
+    
+    // binding attaches the index buffer to the bound VAO, make sure it's the one of this buffer
+    bool elements = _target == GL_ELEMENT_ARRAY_BUFFER;
+    if (elements) {
+        GLFK_AUTO_BIND_OBJ(_vao);
+    }
+    GLFK_AUTO_BIND();
+    glBufferStorage(_target, size, NULL, flags);
+    data->mapped = (unsigned char*)glMapBufferRange(_target, 0, size, flags);
+    if (elements) {
+        GLFK_AUTO_UNBIND_OBJ(_vao);
+    } else {
+        GLFK_AUTO_UNBIND();
+    }
+}
+
+void* StreamBuffer::Allocate(GLsizeiptr size, GLintptr& offset, GLsizeiptr alignment)
+{
+    StreamData* data = GetData();
+    GLsizeiptr start = (data->head + alignment - 1) / alignment * alignment;
+    if (start + size > data->regionSize) {
+        return NULL;
+    }
+    data->head = start + size;
+    offset = RegionStart() + start;
+    
+    if (data->persistent) {
+        return data->mapped + offset;
+    }
+    
+    if (!data->mapped) {
+        // fences guard the region, so the driver doesn't need to synchronize
+        GLintptr from = RegionStart() + data->flushed;
+        GLsizeiptr length = data->regionSize - data->flushed;
+        GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                            GL_MAP_FLUSH_EXPLICIT_BIT;
+        if (Renderer::HasDirectStateAccess()) {
+            data->mapped = (unsigned char*)glMapNamedBufferRange(*this, from, length, access);
+        } else {
+            GLFK_AUTO_BIND();
+            data->mapped = (unsigned char*)glMapBufferRange(_target, from, length, access);
+            GLFK_AUTO_UNBIND();
+        }
+        if (!data->mapped) {
+            return NULL;
+        }
+    }
+    return data->mapped + (start - data->flushed);
+}
+
+StreamBuffer& StreamBuffer::Flush()
+{
+    StreamData* data = GetData();
+    if (data->persistent || !data->mapped) {
+        return *this;
+    }
+    
+    // flush range is relative to the mapped range
+    GLsizeiptr length = data->head - data->flushed;
+    if (Renderer::HasDirectStateAccess()) {
+        glFlushMappedNamedBufferRange(*this, 0, length);
+        glUnmapNamedBuffer(*this);
+    } else {
+        GLFK_AUTO_BIND();
+        glFlushMappedBufferRange(_target, 0, length);
+        glUnmapBuffer(_target);
+        GLFK_AUTO_UNBIND();
+    }
+    data->mapped = NULL;
+    data->flushed = data->head;
+    return *this;
+}
+
+StreamBuffer& StreamBuffer::NextFrame()
+{
+    Flush();
+    
+    StreamData* data = GetData();
+    data->fences[data->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    data->region = (data->region + 1) % data->fences.size();
+    data->head = 0;
+    data->flushed = 0;
+    
+    GLsync& fence = data->fences[data->region];
+    if (!fence) {
+        return *this;
+    }
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        ++data->stalls;
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+        }
+    }
+    glDeleteSync(fence);
+    fence = 0;
+    return *this;
+}
@@ -8,7 +8,7 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 #include "Utils.h"
 #include "VertexArray.h"
 
-#include <map>
+#include <vector>
 
 /// Vertex Buffer Object (VBO)
 class BaseBuffer : public GLObject
@@ -20,19 +20,73 @@ public:
     static void BindNone(GLenum target);
     BaseBuffer& Unbind(GLenum target){ BindNone(target); return *this; };
     
+    /// Bind the buffer to the indexed binding point of the target (uniform, transform feedback, shader storage...)
+    BaseBuffer& BindBase(GLenum target, GLuint index);
+    /// Bind range of the buffer to the indexed binding point of the target. Offset must be aligned as required by the target.
+    BaseBuffer& BindRange(GLenum target, GLuint index, GLintptr offset, GLsizeiptr size);
+    
     /// Set data to the buffer
     BaseBuffer& SetData(GLenum target, GLsizeiptr size, const GLvoid * data, BufferUsage::E usage = BufferUsage::STATIC_DRAW);
-
-private:
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-    typedef std::map<GLenum, GLuint> TargetBufferMap;
-    static TargetBufferMap s_boundBufferToTarget;
-#endif
+    /// Update part of the buffer immediately
+    BaseBuffer& SetSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid * data);
+    /// Re-specify the storage with the size and usage of the last SetData, so the driver can hand out new memory
+    /// instead of waiting for draws using the old contents. Contents are undefined afterwards.
+    BaseBuffer& Orphan(GLenum target);
     
+    /// Map range of the buffer, access is a combination of MapAccess bits. Returns NULL on failure.
+    void* MapRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    /// Flush part of a range mapped with MapAccess::FLUSH_EXPLICIT, offset is relative to the mapped range
+    BaseBuffer& FlushMappedRange(GLenum target, GLintptr offset, GLsizeiptr length);
+    /// Unmap the buffer, returns false if the contents got corrupted while mapped and must be uploaded again
+    bool Unmap(GLenum target);
+    
+    /** Copy data to the CPU-side copy of the buffer and mark the range dirty.
+    Dirty ranges are uploaded by FlushSubData(), touching and overlapping edits are coalesced into one upload.
+    The range must be within the size given to SetData(), writes past it are rejected. */
+    BaseBuffer& WriteSubData(GLintptr offset, GLsizeiptr size, const GLvoid * data);
+    /// Upload dirty ranges written by WriteSubData
+    BaseBuffer& FlushSubData(GLenum target);
+    /// Returns number of pending dirty ranges
+    unsigned GetDirtyRangeCount()const;
+    
+    /// Returns size set by the last SetData, 0 if not set
+    GLsizeiptr GetSize()const{
+        const BufferData* data = (const BufferData*)GetSharedData();
+        return data ? data->size : 0;
+    };
+    /// Returns usage set by the last SetData
+    BufferUsage::E GetUsage()const{
+        const BufferData* data = (const BufferData*)GetSharedData();
+        return data ? data->usage : BufferUsage::STATIC_DRAW;
+    };
+
 protected:
+    /// Half-open byte range [begin, end)
+    struct ByteRange {
+        GLintptr begin;
+        GLintptr end;
+    };
+    
+    /// Data of the buffer shared by all copies
+    struct BufferData : public GLObjectData {
+        BufferData() : size(0), usage(BufferUsage::STATIC_DRAW) {};
+        
+        GLsizeiptr size;
+        BufferUsage::E usage;
+        std::vector<unsigned char> shadow; ///< CPU-side copy written by WriteSubData
+        std::vector<ByteRange> dirty; ///< sorted and disjoint
+    };
+    
+    BufferData* GetBufferData();
+    
     VertexArray _vao;
 };
 
+/// Maximum number of dirty ranges of a buffer, WriteSubData uploads the pending ranges when it is reached
+#ifndef GLFK_MAX_DIRTY_RANGES
+# define GLFK_MAX_DIRTY_RANGES 16
+#endif
+
 /// Vertex Buffer Object (VBO) for a single target
 class Buffer : public BaseBuffer
 {
@@ -40,10 +94,28 @@ public:
     Buffer(VertexArray vao, GLenum target) : BaseBuffer(vao), _target(target) { }
     Buffer& Bind() { return (Buffer&)BaseBuffer::Bind(_target); }
     Buffer& Unbind() { return (Buffer&)BaseBuffer::Unbind(_target); }
+    Buffer& BindBase(GLuint index) { return (Buffer&)BaseBuffer::BindBase(_target, index); }
+    Buffer& BindRange(GLuint index, GLintptr offset, GLsizeiptr size) {
+        return (Buffer&)BaseBuffer::BindRange(_target, index, offset, size);
+    }
     
     Buffer& SetData(GLsizeiptr size, const GLvoid * data, BufferUsage::E usage = BufferUsage::STATIC_DRAW) {
         return (Buffer&)BaseBuffer::SetData(_target, size, data, usage);
     }
+    Buffer& SetSubData(GLintptr offset, GLsizeiptr size, const GLvoid * data) {
+        return (Buffer&)BaseBuffer::SetSubData(_target, offset, size, data);
+    }
+    Buffer& Orphan() { return (Buffer&)BaseBuffer::Orphan(_target); }
+    void* MapRange(GLintptr offset, GLsizeiptr length, GLbitfield access) {
+        return BaseBuffer::MapRange(_target, offset, length, access);
+    }
+    Buffer& FlushMappedRange(GLintptr offset, GLsizeiptr length) {
+        return (Buffer&)BaseBuffer::FlushMappedRange(_target, offset, length);
+    }
+    bool Unmap() { return BaseBuffer::Unmap(_target); }
+    Buffer& FlushSubData() { return (Buffer&)BaseBuffer::FlushSubData(_target); }
+    
+    GLenum GetTarget()const{ return _target; }
 
 protected:
     GLenum _target;	
@@ -57,6 +129,8 @@ public:
     
     /// Enables or disables the specified attribute array index
     ArrayBuffer& EnableAttribArray(GLuint index, bool enable=true){ _vao.EnableAttribArray(index, enable); return *this; };
+    /// Make the attribute per-instance, advancing once per divisor instances (0 = per vertex)
+    ArrayBuffer& SetAttribDivisor(GLuint index, GLuint divisor){ _vao.SetAttribDivisor(index, divisor); return *this; };
     
     /** Enable attribute array and set array pointer
     \note Will also automatically call EnableAttribArray for the index.
@@ -136,7 +210,62 @@ public:
 class UniformBuffer : public Buffer
 {
 public:
+    UniformBuffer() : Buffer(VertexArray::None(), GL_UNIFORM_BUFFER) {};
     UniformBuffer(VertexArray vao) : Buffer(vao, GL_UNIFORM_BUFFER) {};
+    
+    // helpers
+    
+    /// Returns required alignment of BindRange offsets
+    static unsigned GetOffsetAlignment(){ return Renderer::GetInt(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT); };
+};
+
+/** Buffer for data written by CPU every frame (particles, debug geometry, instance data...)
+
+The storage is split into one region per frame in flight. Allocate() hands out aligned pieces of the current
+region and NextFrame() fences the region and moves to the next one, waiting only if the GPU still reads it.
+With buffer storage (Renderer::HasBufferStorage) the whole buffer is mapped persistently and coherently,
+otherwise the rest of the region is mapped unsynchronized on the first Allocate() and unmapped by Flush().
+*/
+class StreamBuffer : public Buffer
+{
+public:
+    /// \param regionSize Size of data written per frame
+    /// \param regions Number of frames the CPU may write ahead of the GPU
+    StreamBuffer(VertexArray vao, GLenum target, GLsizeiptr regionSize, unsigned regions = 3);
+    
+    /** Returns pointer to size bytes of the current region or NULL if the region is full.
+    \param offset Receives offset of the allocated piece in the buffer, to be used as attribute pointer, indices offset etc.
+    \note Without persistent mapping the pointers are valid until Flush() or NextFrame() only */
+    void* Allocate(GLsizeiptr size, GLintptr& offset, GLsizeiptr alignment = 16);
+    /// Make data written since last flush visible to GL, call before drawing from the allocated pieces
+    StreamBuffer& Flush();
+    /// Fence the current region and switch to the next one
+    StreamBuffer& NextFrame();
+    
+    bool IsPersistent()const{ return GetData()->persistent; };
+    GLsizeiptr GetRegionSize()const{ return GetData()->regionSize; };
+    unsigned GetRegionCount()const{ return GetData()->fences.size(); };
+    /// Returns number of NextFrame() calls which had to wait for the GPU
+    unsigned GetStallCount()const{ return GetData()->stalls; };
+    
+private:
+    /// Mapping and fences shared by all copies of the buffer
+    struct StreamData : public BufferData {
+        StreamData() : mapped(NULL), persistent(false), regionSize(0), region(0), head(0), flushed(0), stalls(0) {};
+        ~StreamData();
+        
+        unsigned char* mapped; ///< persistent mapping of the whole buffer or the mapped part of the current region
+        bool persistent;
+        GLsizeiptr regionSize;
+        unsigned region;
+        GLsizeiptr head; ///< allocated bytes of the current region
+        GLsizeiptr flushed; ///< bytes of the current region visible to GL (fallback mapping)
+        unsigned stalls;
+        std::vector<GLsync> fences;
+    };
+    
+    StreamData* GetData()const{ return (StreamData*)GetSharedData(); };
+    GLintptr RegionStart()const{ return GetData()->region * GetData()->regionSize; };
 };
 
 
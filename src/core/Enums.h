@@ -28,6 +28,22 @@ GLFK_ENUM(BufferUsage) {
     DYNAMIC_COPY = GL_DYNAMIC_COPY
 }GLFK_ENUM_END;
 
+/// Access bits of mapped buffer ranges, can be combined using |
+GLFK_ENUM(MapAccess) {
+    READ = GL_MAP_READ_BIT,
+    WRITE = GL_MAP_WRITE_BIT,
+    /// previous contents of the range may be discarded
+    INVALIDATE_RANGE = GL_MAP_INVALIDATE_RANGE_BIT,
+    /// previous contents of the entire buffer may be discarded
+    INVALIDATE_BUFFER = GL_MAP_INVALIDATE_BUFFER_BIT,
+    /// modified subranges must be flushed by FlushMappedRange
+    FLUSH_EXPLICIT = GL_MAP_FLUSH_EXPLICIT_BIT,
+    /// GL doesn't wait for pending operations using the buffer
+    UNSYNCHRONIZED = GL_MAP_UNSYNCHRONIZED_BIT,
+    PERSISTENT = GL_MAP_PERSISTENT_BIT,
+    COHERENT = GL_MAP_COHERENT_BIT
+}GLFK_ENUM_END;
+
 GLFK_ENUM(AttribType) {
     BYTE = GL_BYTE,
     UNSIGNED_BYTE = GL_UNSIGNED_BYTE,
@@ -290,6 +306,17 @@ GLFK_ENUM(ShaderAttribType) {
     MAT4 = GL_FLOAT_MAT4,
 }GLFK_ENUM_END;
 
+/// Shader stages of a program pipeline, can be combined using |
+GLFK_ENUM(ProgramStage) {
+    VERTEX = GL_VERTEX_SHADER_BIT,
+    TESS_CONTROL = GL_TESS_CONTROL_SHADER_BIT,
+    TESS_EVALUATION = GL_TESS_EVALUATION_SHADER_BIT,
+    GEOMETRY = GL_GEOMETRY_SHADER_BIT,
+    FRAGMENT = GL_FRAGMENT_SHADER_BIT,
+    COMPUTE = GL_COMPUTE_SHADER_BIT,
+    ALL = GL_ALL_SHADER_BITS
+}GLFK_ENUM_END;
+
 GLFK_ENUM(ShaderUniformType) {
     FLOAT = GL_FLOAT,
     FLOAT_VEC2 = GL_FLOAT_VEC2,
@@ -0,0 +1,65 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#include "Fence.h"
+
+#include <stdio.h>
+
+const GLuint64 Fence::FOREVER;
+
+Fence& Fence::Insert()
+{
+    FenceData* data = new FenceData;
+    data->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    SetSharedData(data);
+    return *this;
+}
+
+Fence& Fence::Reset()
+{
+    SetSharedData(NULL);
+    return *this;
+}
+
+bool Fence::IsSignaled()
+{
+    FenceData* data = (FenceData*)GetSharedData();
+    if (!data || data->signaled) {
+        return true;
+    }
+
+    GLenum status = glClientWaitSync(data->sync, 0, 0);
+    data->signaled = status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    return data->signaled;
+}
+
+bool Fence::ClientWait(GLuint64 timeout)
+{
+    FenceData* data = (FenceData*)GetSharedData();
+    if (!data || data->signaled) {
+        return true;
+    }
+
+    // drivers may limit the timeout, wait in steps of a second when waiting forever
+    GLuint64 step = timeout == FOREVER ? 1000000000 : timeout;
+    GLenum status;
+    do {
+        status = glClientWaitSync(data->sync, GL_SYNC_FLUSH_COMMANDS_BIT, step);
+    } while (status == GL_TIMEOUT_EXPIRED && timeout == FOREVER);
+
+    if (status == GL_WAIT_FAILED) {
+        printf("%s: wait failed!\n", __FUNCTION__);
+    }
+    data->signaled = status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    return data->signaled;
+}
+
+Fence& Fence::ServerWait()
+{
+    FenceData* data = (FenceData*)GetSharedData();
+    if (data && !data->signaled) {
+        glWaitSync(data->sync, 0, GL_TIMEOUT_IGNORED);
+    }
+    return *this;
+}
@@ -0,0 +1,57 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "Renderer.h"
+
+/** Sync object signaled when the GPU finishes all commands issued before Insert()
+
+Copies share the sync object like other GL objects, it's deleted together with the last copy.
+A fence has no GL name, the sync object is kept in its shared data.
+*/
+class Fence : public GLObject
+{
+public:
+    /// Timeout of ClientWait() waiting until the fence is signaled
+    static const GLuint64 FOREVER = ~(GLuint64)0;
+
+    /// Create an empty fence, Insert() puts it into the command stream
+    Fence(){};
+
+    /// Insert the fence after commands issued so far, replacing the previous sync object
+    Fence& Insert();
+    /// Delete the sync object, the fence is empty again
+    Fence& Reset();
+    /// Returns true if the fence was inserted and not reset
+    bool IsInserted()const{ return GetSync() != NULL; };
+
+    /// Returns true if the GPU passed the fence, doesn't block. An empty fence is signaled.
+    bool IsSignaled();
+    /// Block the calling thread until the fence is signaled or the timeout in nanoseconds expires.
+    /// Flushes the commands, so the fence gets to the GPU. Returns true if signaled.
+    bool ClientWait(GLuint64 timeout = FOREVER);
+    /// Make the GPU wait for the fence before executing following commands, e.g. of another context. Doesn't block.
+    Fence& ServerWait();
+
+    /// Returns the sync object, NULL if empty
+    GLsync GetSync()const{
+        const FenceData* data = (const FenceData*)GetSharedData();
+        return data ? data->sync : NULL;
+    };
+
+private:
+    struct FenceData : public GLObjectData {
+        FenceData() : sync(NULL), signaled(false) {};
+        ~FenceData(){
+            if (sync) {
+                glDeleteSync(sync);
+            }
+        };
+
+        GLsync sync;
+        /// Signal seen already, no need to ask GL again
+        bool signaled;
+    };
+};
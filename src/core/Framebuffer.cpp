@@ -4,24 +4,26 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 -*/
 #include "Framebuffer.h"
 
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-BaseFramebuffer::TargetFramebufferMap BaseFramebuffer::s_boundFramebufferToTarget;
-#endif
+/// Creates names of framebuffers deferred by the constructor
+static void CreateFramebuffers(GLenum, GLsizei n, GLuint* names)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        glCreateFramebuffers(n, names);
+    } else {
+        glGenFramebuffers(n, names);
+    }
+}
 
 BaseFramebuffer::BaseFramebuffer()
 {
-    GLuint obj;
-    glGenFramebuffers(1, &obj);
-    
-    AssignGLObject(obj, glDeleteFramebuffers);
+    DeferGLObject(CreateFramebuffers, 0, glDeleteFramebuffers);
 }
 
 BaseFramebuffer& BaseFramebuffer::Bind(GLenum target)
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundFramebufferToTarget[target] == *this)
+    if (!GLStateCache::Current().SetFramebuffer(target, *this))
         return *this;
-    s_boundFramebufferToTarget[target] = *this;
 #endif
     glBindFramebuffer(target, *this);
     return *this;
@@ -29,15 +31,18 @@ BaseFramebuffer& BaseFramebuffer::Bind(GLenum target)
 void BaseFramebuffer::BindNone(GLenum target)
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundFramebufferToTarget[target] == 0)
+    if (!GLStateCache::Current().SetFramebuffer(target, 0))
         return;
-    s_boundFramebufferToTarget[target] = 0;
 #endif
     glBindFramebuffer(target, 0);
 }
 
 FramebufferStatus::E BaseFramebuffer::CheckStatus(GLenum target)
 {
+    if (Renderer::HasDirectStateAccess()) {
+        return (FramebufferStatus::E)glCheckNamedFramebufferStatus(*this, target);
+    }
+    
     GLFK_AUTO_BIND(target);
     
     GLenum ret = glCheckFramebufferStatus(target);
@@ -48,6 +53,11 @@ FramebufferStatus::E BaseFramebuffer::CheckStatus(GLenum target)
 
 BaseFramebuffer& BaseFramebuffer::AttachRenderbuffer(GLenum target, FramebufferAttachment::E attachment, GLuint renderbuffer)
 {
+    if (Renderer::HasDirectStateAccess()) {
+        glNamedFramebufferRenderbuffer(*this, attachment, GL_RENDERBUFFER, renderbuffer);
+        return *this;
+    }
+    
     GLFK_AUTO_BIND(target);
     
     glFramebufferRenderbuffer(target, attachment, GL_RENDERBUFFER, renderbuffer);
@@ -58,6 +68,11 @@ BaseFramebuffer& BaseFramebuffer::AttachRenderbuffer(GLenum target, FramebufferA
 
 BaseFramebuffer& BaseFramebuffer::AttachTexture1D(GLenum target, FramebufferAttachment::E attachment, GLuint texture, GLint level)
 {
+    if (Renderer::HasDirectStateAccess()) {
+        glNamedFramebufferTexture(*this, attachment, texture, level);
+        return *this;
+    }
+    
     GLFK_AUTO_BIND(target);
     
     glFramebufferTexture1D(target, attachment, GL_TEXTURE_1D, texture, level);
@@ -68,6 +83,16 @@ BaseFramebuffer& BaseFramebuffer::AttachTexture1D(GLenum target, FramebufferAtta
 
 BaseFramebuffer& BaseFramebuffer::AttachTexture2D(GLenum target, FramebufferAttachment::E attachment, GLenum textarget, GLuint texture, GLint level)
 {
+    if (Renderer::HasDirectStateAccess()) {
+        if (textarget >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && textarget <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z) {
+            // DSA addresses cube faces as layers
+            glNamedFramebufferTextureLayer(*this, attachment, texture, level, textarget - GL_TEXTURE_CUBE_MAP_POSITIVE_X);
+        } else {
+            glNamedFramebufferTexture(*this, attachment, texture, level);
+        }
+        return *this;
+    }
+    
     GLFK_AUTO_BIND(target);
     
     glFramebufferTexture2D(target, attachment, textarget, texture, level);
@@ -78,6 +103,11 @@ BaseFramebuffer& BaseFramebuffer::AttachTexture2D(GLenum target, FramebufferAtta
 
 BaseFramebuffer& BaseFramebuffer::AttachTexture3D(GLenum target, FramebufferAttachment::E attachment, GLuint texture, GLint level, GLint layer)
 {
+    if (Renderer::HasDirectStateAccess()) {
+        glNamedFramebufferTextureLayer(*this, attachment, texture, level, layer);
+        return *this;
+    }
+    
     GLFK_AUTO_BIND(target);
     
     glFramebufferTexture3D(target, attachment, GL_TEXTURE_3D, texture, level, layer);
@@ -113,11 +143,10 @@ FramebufferWithTarget& FramebufferWithTarget::ReadPixels(GLint x, GLint y, GLsiz
 
 Framebuffer& Framebuffer::Screen()
 {
+    // never deleted, static destructors may run without a context
     static Framebuffer* fb = NULL;
     if (!fb) {
-        fb = (Framebuffer*)malloc(sizeof(Framebuffer));
-        fb->_obj = 0;
-        fb->_target = GL_FRAMEBUFFER;
+        fb = new Framebuffer(NoObject());
     }
     return *fb;
 };
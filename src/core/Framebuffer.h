@@ -6,8 +6,6 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 
 #include "Renderer.h"
 
-#include <map>
-
 /// Framebufer Object (FBO)
 class BaseFramebuffer : public GLObject
 {
@@ -37,12 +35,9 @@ public:
     }
     BaseFramebuffer& Clear(GLenum target, GLbitfield mask = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     unsigned GetMaxColorAttachments(){ return Renderer::GetInt(GL_MAX_COLOR_ATTACHMENTS); };
-
-private:
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-    typedef std::map<GLenum, GLuint> TargetFramebufferMap;
-    static TargetFramebufferMap s_boundFramebufferToTarget;
-#endif
+    
+protected:
+    BaseFramebuffer(NoObject) : GLObject(NoObject()) {};
 };
 
 /// Framebufer Object (FBO) with a specific target
@@ -92,6 +87,9 @@ public:
     }
     
 protected:
+    /// Framebuffer without a GL object, e.g. the default framebuffer
+    FramebufferWithTarget(GLenum target, NoObject) : BaseFramebuffer(NoObject()), _target(target) {};
+    
     GLenum _target;
 };
 
@@ -101,6 +99,9 @@ class Framebuffer : public FramebufferWithTarget
 public:
     Framebuffer() : FramebufferWithTarget(GL_FRAMEBUFFER) {};
     static Framebuffer& Screen();
+    
+private:
+    Framebuffer(NoObject) : FramebufferWithTarget(GL_FRAMEBUFFER, NoObject()) {};
 };
 Framebuffer& Screen();
 
@@ -4,24 +4,24 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 -*/
 #include "Renderbuffer.h"
 
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-GLuint Renderbuffer::s_boundRenderbuffer;
-#endif
+/// Creates names of renderbuffers deferred by the constructor
+static void CreateRenderbuffers(GLenum, GLsizei n, GLuint* names)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        glCreateRenderbuffers(n, names);
+    } else {
+        glGenRenderbuffers(n, names);
+    }
+}
 
 Renderbuffer::Renderbuffer()
 {
-    GLuint obj;
-    glGenRenderbuffers(1, &obj);
-    
-    AssignGLObject(obj, glDeleteRenderbuffers);
+    DeferGLObject(CreateRenderbuffers, 0, glDeleteRenderbuffers);
 }
 
 Renderbuffer::Renderbuffer(InternalFormat::E internalformat, GLsizei width, GLsizei height)
 {
-    GLuint obj;
-    glGenRenderbuffers(1, &obj);
-    
-    AssignGLObject(obj, glDeleteRenderbuffers);
+    DeferGLObject(CreateRenderbuffers, 0, glDeleteRenderbuffers);
     
     SetStorage(internalformat, width, height);
 }
@@ -29,9 +29,8 @@ Renderbuffer::Renderbuffer(InternalFormat::E internalformat, GLsizei width, GLsi
 Renderbuffer& Renderbuffer::Bind()
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundRenderbuffer == *this)
+    if (!GLStateCache::Current().SetRenderbuffer(*this))
         return *this;
-    s_boundRenderbuffer = *this;
 #endif
     glBindRenderbuffer(GL_RENDERBUFFER, *this);
     return *this;
@@ -40,15 +39,19 @@ Renderbuffer& Renderbuffer::Bind()
 void Renderbuffer::BindNone()
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundRenderbuffer == 0)
+    if (!GLStateCache::Current().SetRenderbuffer(0))
         return;
-    s_boundRenderbuffer = 0;
 #endif
-    glBindBuffer(GL_RENDERBUFFER, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
 }
 
 Renderbuffer& Renderbuffer::SetStorage(InternalFormat::E internalformat, GLsizei width, GLsizei height)
 {
+    if (Renderer::HasDirectStateAccess()) {
+        glNamedRenderbufferStorage(*this, internalformat, width, height);
+        return *this;
+    }
+    
     GLFK_AUTO_BIND();
     
     glRenderbufferStorage(GL_RENDERBUFFER, internalformat, width, height);
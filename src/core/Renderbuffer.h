@@ -20,9 +20,4 @@ public:
     
     /// Set storage for the renderbuffer
     Renderbuffer& SetStorage(InternalFormat::E internalformat, GLsizei width, GLsizei height);
-
-private:
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-    static GLuint s_boundRenderbuffer;
-#endif
 };
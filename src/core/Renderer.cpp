@@ -5,6 +5,12 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 #include "Renderer.h"
 #include "Utils.h"
 
+#include <stdio.h>
+
+#ifdef GLFK_THREAD_SAFE_REFS
+# include <mutex>
+#endif
+
 void Renderer::Clear(GLbitfield mask)
 {
     glClear(mask);
@@ -24,11 +30,96 @@ void Renderer::DrawArrays(DrawMode::E mode, GLint first, GLsizei count)
     glDrawArrays(mode, first, count);
 }
 
+void Renderer::DrawElementsInstanced(DrawMode::E mode, GLsizei count, IndicesType::E type, const GLvoid * indices,
+                                     GLsizei instances)
+{
+    glDrawElementsInstanced(mode, count, type, indices, instances);
+}
+
+void Renderer::DrawArraysInstanced(DrawMode::E mode, GLint first, GLsizei count, GLsizei instances)
+{
+    glDrawArraysInstanced(mode, first, count, instances);
+}
+
+void Renderer::DrawElementsBaseVertex(DrawMode::E mode, GLsizei count, IndicesType::E type, const GLvoid * indices,
+                                      GLint baseVertex)
+{
+    glDrawElementsBaseVertex(mode, count, type, (GLvoid*)indices, baseVertex);
+}
+
+void Renderer::DrawElementsInstancedBaseVertex(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                               const GLvoid * indices, GLsizei instances, GLint baseVertex)
+{
+    glDrawElementsInstancedBaseVertex(mode, count, type, (GLvoid*)indices, instances, baseVertex);
+}
+
+void Renderer::MultiDrawElementsIndirect(DrawMode::E mode, IndicesType::E type, const GLvoid * indirect,
+                                         GLsizei drawCount, GLsizei stride)
+{
+    assert(s_multiDrawIndirect);
+    glMultiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+}
+
+void Renderer::DrawElementsInstancedBaseInstance(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                 const GLvoid * indices, GLsizei instances, GLuint baseInstance)
+{
+    assert(s_baseInstance);
+    glDrawElementsInstancedBaseInstance(mode, count, type, indices, instances, baseInstance);
+}
+
+void Renderer::DrawElementsInstancedBaseVertexBaseInstance(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                           const GLvoid * indices, GLsizei instances,
+                                                           GLint baseVertex, GLuint baseInstance)
+{
+    assert(s_baseInstance);
+    glDrawElementsInstancedBaseVertexBaseInstance(mode, count, type, indices, instances, baseVertex, baseInstance);
+}
+
+void Renderer::DrawArraysInstancedBaseInstance(DrawMode::E mode, GLint first, GLsizei count, GLsizei instances,
+                                               GLuint baseInstance)
+{
+    assert(s_baseInstance);
+    glDrawArraysInstancedBaseInstance(mode, first, count, instances, baseInstance);
+}
+
 void Renderer::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
 {
     glViewport(x, y, width, height);
 }
 
+bool Renderer::s_dsa = false;
+bool Renderer::s_bufferStorage = false;
+bool Renderer::s_baseInstance = false;
+bool Renderer::s_multiDrawIndirect = false;
+bool Renderer::s_programBinary = false;
+bool Renderer::s_parallelShaderCompile = false;
+bool Renderer::s_separateShaderObjects = false;
+
+void Renderer::DetectFeatures()
+{
+    // glad resolves DSA entry points through the extension, which GL 4.5 contexts expose as well
+    s_dsa = GLAD_GL_ARB_direct_state_access && glCreateBuffers != NULL;
+    s_bufferStorage = GLAD_GL_ARB_buffer_storage && glBufferStorage != NULL;
+    s_baseInstance = GLAD_GL_ARB_base_instance && glDrawElementsInstancedBaseInstance != NULL;
+    s_multiDrawIndirect = GLAD_GL_ARB_multi_draw_indirect && glMultiDrawElementsIndirect != NULL;
+    s_programBinary = GLAD_GL_ARB_get_program_binary && GetInt(GL_NUM_PROGRAM_BINARY_FORMATS) > 0;
+    // KHR and ARB variants share the entry point and GL_COMPLETION_STATUS token, the loader knows the ARB one
+    s_parallelShaderCompile = GLAD_GL_ARB_parallel_shader_compile && glMaxShaderCompilerThreadsARB != NULL;
+    s_separateShaderObjects = GLAD_GL_ARB_separate_shader_objects && glBindProgramPipeline != NULL;
+}
+
+void Renderer::EnableDirectStateAccess(bool enable)
+{
+    s_dsa = enable && GLAD_GL_ARB_direct_state_access && glCreateBuffers != NULL;
+}
+
+void Renderer::SetMaxShaderCompilerThreads(unsigned count)
+{
+    if (s_parallelShaderCompile) {
+        glMaxShaderCompilerThreadsARB(count);
+    }
+}
+
 GLint Renderer::GetInt(GLenum pname)
 {
     GLint val;
@@ -58,3 +149,734 @@ unsigned Renderer::GetMaxTextureUnits()
     
     return (s_max = GetInt(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS));
 }
+
+unsigned Renderer::GetIndexSize(IndicesType::E type)
+{
+    switch (type) {
+        case IndicesType::UNSIGNED_BYTE:
+            return 1;
+        case IndicesType::UNSIGNED_SHORT:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+//-----------------------------------------------------------------------
+
+static GLStateCache s_defaultStateCache;
+GLStateCache* GLStateCache::s_current = &s_defaultStateCache;
+#ifdef GLFK_THREAD_SAFE_REFS
+thread_local GLStateCache* GLStateCache::s_threadCurrent = NULL;
+#endif
+
+GLStateCache::GLStateCache()
+{
+    Invalidate();
+#ifdef GLFK_THREAD_SAFE_REFS
+    _thread = std::this_thread::get_id();
+#endif
+}
+
+GLStateCache::~GLStateCache()
+{
+    if (this == &s_defaultStateCache) {
+        return; // static destruction, the pool may be gone already
+    }
+    GLObject::MovePending(this, NULL);
+#ifdef GLFK_THREAD_SAFE_REFS
+    GLObject::RehomeShared(this, &s_defaultStateCache, true);
+    // objects queued before the blocks were re-homed, their GL objects went with the context
+    _releaseQueue.Drain();
+    if (s_current == this) {
+        s_current = &s_defaultStateCache;
+    }
+#endif
+}
+
+GLStateCache& GLStateCache::GetDefault()
+{
+    return s_defaultStateCache;
+}
+
+void GLStateCache::MakeCurrent(GLStateCache* cache)
+{
+#ifdef GLFK_THREAD_SAFE_REFS
+    GLStateCache* prev = s_threadCurrent;
+    s_threadCurrent = cache;
+    // the first cache made current is used by threads without a context of their own
+    if (!cache && s_current == prev) {
+        s_current = &s_defaultStateCache;
+    } else if (cache && s_current == &s_defaultStateCache) {
+        s_current = cache;
+        // objects constructed before the context belong to it, nothing was created without a context yet
+        GLObject::RehomeShared(&s_defaultStateCache, cache, false);
+        GLObject::MovePending(&s_defaultStateCache, cache);
+        s_defaultStateCache._releaseQueue.Drain();
+    }
+    if (cache) {
+        cache->_thread = std::this_thread::get_id();
+    }
+#else
+    s_current = cache ? cache : &s_defaultStateCache;
+#endif
+}
+
+void GLStateCache::Invalidate()
+{
+    for (unsigned i=0; i<NUM_BUFFER_TARGETS; i++) {
+        _buffers[i] = UNKNOWN;
+    }
+    for (unsigned u=0; u<GLFK_STATE_CACHE_TEXTURE_UNITS; u++) {
+        for (unsigned i=0; i<NUM_TEXTURE_TARGETS; i++) {
+            _textures[u][i] = UNKNOWN;
+        }
+    }
+    for (unsigned i=0; i<NUM_FRAMEBUFFER_TARGETS; i++) {
+        _framebuffers[i] = UNKNOWN;
+    }
+    _renderbuffer = UNKNOWN;
+    _array = UNKNOWN;
+    _program = UNKNOWN;
+    _pipeline = UNKNOWN;
+    _activeUnit = UNKNOWN;
+}
+
+void GLStateCache::Forget(GLuint obj)
+{
+    if (obj == 0) {
+        return;
+    }
+    
+    // names are per object type, so this may forget a few unrelated bindings which only costs an extra bind
+    for (unsigned i=0; i<NUM_BUFFER_TARGETS; i++) {
+        if (_buffers[i] == obj) {
+            _buffers[i] = UNKNOWN;
+        }
+    }
+    for (unsigned u=0; u<GLFK_STATE_CACHE_TEXTURE_UNITS; u++) {
+        for (unsigned i=0; i<NUM_TEXTURE_TARGETS; i++) {
+            if (_textures[u][i] == obj) {
+                _textures[u][i] = UNKNOWN;
+            }
+        }
+    }
+    for (unsigned i=0; i<NUM_FRAMEBUFFER_TARGETS; i++) {
+        if (_framebuffers[i] == obj) {
+            _framebuffers[i] = UNKNOWN;
+        }
+    }
+    if (_renderbuffer == obj) {
+        _renderbuffer = UNKNOWN;
+    }
+    if (_array == obj) {
+        _array = UNKNOWN;
+        _buffers[BufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+    }
+    if (_program == obj) {
+        _program = UNKNOWN;
+    }
+    if (_pipeline == obj) {
+        _pipeline = UNKNOWN;
+    }
+}
+
+int GLStateCache::BufferTargetIndex(GLenum target)
+{
+    switch (target) {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_ELEMENT_ARRAY_BUFFER: return 1;
+        case GL_COPY_READ_BUFFER: return 2;
+        case GL_COPY_WRITE_BUFFER: return 3;
+        case GL_DRAW_INDIRECT_BUFFER: return 4;
+        case GL_DISPATCH_INDIRECT_BUFFER: return 5;
+        case GL_PIXEL_PACK_BUFFER: return 6;
+        case GL_PIXEL_UNPACK_BUFFER: return 7;
+        case GL_TEXTURE_BUFFER: return 8;
+        case GL_TRANSFORM_FEEDBACK_BUFFER: return 9;
+        case GL_UNIFORM_BUFFER: return 10;
+        case GL_SHADER_STORAGE_BUFFER: return 11;
+        case GL_ATOMIC_COUNTER_BUFFER: return 12;
+        case GL_QUERY_BUFFER: return 13;
+        default: return -1;
+    }
+}
+
+int GLStateCache::TextureTargetIndex(GLenum target)
+{
+    switch (target) {
+        case GL_TEXTURE_1D: return 0;
+        case GL_TEXTURE_2D: return 1;
+        case GL_TEXTURE_3D: return 2;
+        case GL_TEXTURE_CUBE_MAP: return 3;
+        case GL_TEXTURE_1D_ARRAY: return 4;
+        case GL_TEXTURE_2D_ARRAY: return 5;
+        case GL_TEXTURE_RECTANGLE: return 6;
+        case GL_TEXTURE_BUFFER: return 7;
+        case GL_TEXTURE_CUBE_MAP_ARRAY: return 8;
+        case GL_TEXTURE_2D_MULTISAMPLE: return 9;
+        case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: return 10;
+        default: return -1;
+    }
+}
+
+bool GLStateCache::SetBuffer(GLenum target, GLuint buffer)
+{
+    int i = BufferTargetIndex(target);
+    if (i < 0) {
+        return true;
+    } else if (_buffers[i] == buffer) {
+        return false;
+    }
+    _buffers[i] = buffer;
+    return true;
+}
+
+bool GLStateCache::SetActiveTexture(unsigned unit)
+{
+    if (_activeUnit == unit) {
+        return false;
+    }
+    _activeUnit = unit;
+    return true;
+}
+
+bool GLStateCache::SetTexture(GLenum target, GLuint texture)
+{
+    return SetTexture(_activeUnit, target, texture);
+}
+
+bool GLStateCache::SetTexture(unsigned unit, GLenum target, GLuint texture)
+{
+    int i = TextureTargetIndex(target);
+    if (i < 0 || unit >= GLFK_STATE_CACHE_TEXTURE_UNITS) {
+        return true; // also covers the unknown active unit
+    } else if (_textures[unit][i] == texture) {
+        return false;
+    }
+    _textures[unit][i] = texture;
+    return true;
+}
+
+void GLStateCache::ForgetBuffer(GLenum target)
+{
+    int i = BufferTargetIndex(target);
+    if (i >= 0) {
+        _buffers[i] = UNKNOWN;
+    }
+}
+
+bool GLStateCache::SetFramebuffer(GLenum target, GLuint framebuffer)
+{
+    if (target == GL_DRAW_FRAMEBUFFER) {
+        if (_framebuffers[0] == framebuffer) {
+            return false;
+        }
+        _framebuffers[0] = framebuffer;
+        return true;
+    } else if (target == GL_READ_FRAMEBUFFER) {
+        if (_framebuffers[1] == framebuffer) {
+            return false;
+        }
+        _framebuffers[1] = framebuffer;
+        return true;
+    }
+    
+    // GL_FRAMEBUFFER binds both draw and read targets
+    if (_framebuffers[0] == framebuffer && _framebuffers[1] == framebuffer) {
+        return false;
+    }
+    _framebuffers[0] = _framebuffers[1] = framebuffer;
+    return true;
+}
+
+bool GLStateCache::SetRenderbuffer(GLuint renderbuffer)
+{
+    if (_renderbuffer == renderbuffer) {
+        return false;
+    }
+    _renderbuffer = renderbuffer;
+    return true;
+}
+
+bool GLStateCache::SetVertexArray(GLuint array)
+{
+    if (_array == array) {
+        return false;
+    }
+    _array = array;
+    // element array buffer binding is part of the VAO state
+    _buffers[BufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+    return true;
+}
+
+bool GLStateCache::SetProgram(GLuint program)
+{
+    if (_program == program) {
+        return false;
+    }
+    _program = program;
+    return true;
+}
+
+bool GLStateCache::SetProgramPipeline(GLuint pipeline)
+{
+    if (_pipeline == pipeline) {
+        return false;
+    }
+    _pipeline = pipeline;
+    return true;
+}
+
+// ---------------------------------------------------------------
+
+/// Number of reference count blocks allocated at once by GLObject
+#ifndef GLFK_SHARED_POOL_SLAB_SIZE
+# define GLFK_SHARED_POOL_SLAB_SIZE 1024
+#endif
+
+GLObject::Shared* GLObject::s_freeShared = NULL;
+#ifdef GLFK_THREAD_SAFE_REFS
+std::vector<GLObject::Shared*> GLObject::s_slabs;
+#endif
+
+#ifdef GLFK_THREAD_SAFE_REFS
+/// Contexts and loading threads may create and delete objects
+static std::mutex s_sharedPoolMutex;
+static std::mutex s_pendingMutex;
+#endif
+
+GLObject::Shared* GLObject::AllocShared()
+{
+#ifdef GLFK_THREAD_SAFE_REFS
+    std::lock_guard<std::mutex> lock(s_sharedPoolMutex);
+#endif
+    if (!s_freeShared) {
+        Shared* slab = new Shared[GLFK_SHARED_POOL_SLAB_SIZE];
+        for (unsigned i=0; i<GLFK_SHARED_POOL_SLAB_SIZE - 1; i++) {
+            slab[i].nextFree = &slab[i + 1];
+        }
+#ifdef GLFK_THREAD_SAFE_REFS
+        for (unsigned i=0; i<GLFK_SHARED_POOL_SLAB_SIZE; i++) {
+            slab[i].owner = NULL;
+        }
+        s_slabs.push_back(slab);
+#endif
+        slab[GLFK_SHARED_POOL_SLAB_SIZE - 1].nextFree = NULL;
+        s_freeShared = slab;
+    }
+    
+    Shared* shared = s_freeShared;
+    s_freeShared = shared->nextFree;
+    shared->refs = 1;
+    shared->obj = 0;
+    shared->del1 = NULL;
+    shared->del2 = NULL;
+    shared->create = NULL;
+    shared->createParam = 0;
+    shared->pendingCache = NULL;
+    shared->pendingIndex = 0;
+    shared->data = NULL;
+#ifdef GLFK_THREAD_SAFE_REFS
+    shared->owner = &GLStateCache::Current();
+    shared->nextRelease = NULL;
+#endif
+    return shared;
+}
+
+#ifdef GLFK_THREAD_SAFE_REFS
+void GLObject::RehomeShared(GLStateCache* from, GLStateCache* to, bool dropObjects)
+{
+    std::lock_guard<std::mutex> lock(s_sharedPoolMutex);
+    for (unsigned s=0; s<s_slabs.size(); s++) {
+        Shared* slab = s_slabs[s];
+        for (unsigned i=0; i<GLFK_SHARED_POOL_SLAB_SIZE; i++) {
+            if (slab[i].owner.load(std::memory_order_relaxed) != from) {
+                continue;
+            }
+            if (dropObjects) {
+                slab[i].del1 = NULL;
+                slab[i].del2 = NULL;
+            }
+            slab[i].owner.store(to, std::memory_order_release);
+        }
+    }
+}
+#endif
+
+void GLObject::FreeShared(Shared* shared)
+{
+#ifdef GLFK_THREAD_SAFE_REFS
+    std::lock_guard<std::mutex> lock(s_sharedPoolMutex);
+#endif
+    shared->nextFree = s_freeShared;
+    s_freeShared = shared;
+}
+
+void GLObject::ReleaseShared(Shared* shared)
+{
+    assert(shared->refs > 0); // attempt to release a released object
+#ifdef GLFK_THREAD_SAFE_REFS
+    if (shared->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        bool queued;
+        {
+            // the owner can't be re-homed and destroyed while it's used, see ~GLStateCache
+            std::lock_guard<std::mutex> lock(s_sharedPoolMutex);
+            GLStateCache* owner = shared->owner.load(std::memory_order_acquire);
+            queued = !owner->IsOwnerThread();
+            if (queued) {
+                owner->GetReleaseQueue().Push(shared);
+            }
+        }
+        if (!queued) {
+            DeleteShared(shared);
+        }
+    }
+#else
+    if (--shared->refs == 0) {
+        DeleteShared(shared);
+    }
+#endif
+}
+
+void GLObject::DeleteShared(Shared* shared)
+{
+    {
+        // an object dropped before it was created must not stay on the pending list
+#ifdef GLFK_THREAD_SAFE_REFS
+        std::lock_guard<std::mutex> lock(s_pendingMutex);
+#endif
+        UnlinkPending(shared);
+    }
+    GLuint obj = shared->obj;
+#ifdef GLFK_DEBUG_REF_COUNTING
+    printf("deleting obj %u using %p or %p\n", obj, shared->del1, shared->del2);
+#endif
+    // detached objects and objects of destroyed contexts have no delete function
+    if (obj > 0 && (shared->del1 || shared->del2)) {
+        // the owner, another context may be current on this thread
+#ifdef GLFK_THREAD_SAFE_REFS
+        GLStateCache& cache = *shared->owner.load(std::memory_order_relaxed);
+#else
+        GLStateCache& cache = GLStateCache::Current();
+#endif
+        (void)cache;
+#ifdef GLFK_PREVENT_MULTIPLE_BIND
+        cache.Forget(obj);
+#endif
+#ifdef GLFK_BATCH_GL_NAMES
+        cache.GetDeleteQueue().Push(obj, shared->del1, shared->del2);
+#else
+        if (shared->del1) {
+            shared->del1(obj);
+        } else if (shared->del2) {
+            shared->del2(1, &obj);
+        }
+#endif
+    }
+    delete shared->data;
+    FreeShared(shared);
+}
+
+GLObject& GLObject::DeferGLObject(CreateObjectCallback create, GLenum param)
+{
+    assert(_shared && _shared->obj == 0 && !_shared->create); // assign called second time
+    _shared->create = create;
+    _shared->createParam = param;
+    
+    // the list doesn't hold a reference, RefCount() and Detach() see only the copies; loading threads use the
+    // list of the main context
+    GLStateCache& cache = GLStateCache::Current();
+#ifdef GLFK_THREAD_SAFE_REFS
+    std::lock_guard<std::mutex> lock(s_pendingMutex);
+#endif
+    _shared->pendingCache = &cache;
+    _shared->pendingIndex = cache._pending.size();
+    cache._pending.push_back(_shared);
+    return *this;
+}
+
+GLuint GLObject::Resolve()const
+{
+    if (!_shared) {
+        return 0;
+    }
+    {
+        // create is changed only under the lock, CreatePending may run on the context thread of another object
+#ifdef GLFK_THREAD_SAFE_REFS
+        std::lock_guard<std::mutex> lock(s_pendingMutex);
+#endif
+        if (_shared->create) {
+            // only this object, the other pending objects may belong to another context
+            assert(GLStateCache::IsContextThread()); // GL objects can't be created without a context
+            GLuint obj = 0;
+            _shared->create(_shared->createParam, 1, &obj);
+            _shared->obj = obj;
+            _shared->create = NULL;
+            UnlinkPending(_shared);
+        }
+    }
+    _obj = _shared->obj;
+    return _obj;
+}
+
+void GLObject::UnlinkPending(Shared* shared)
+{
+    if (!shared->pendingCache) {
+        return;
+    }
+    std::vector<Shared*>& pending = shared->pendingCache->_pending;
+    Shared* last = pending.back();
+    pending[shared->pendingIndex] = last;
+    last->pendingIndex = shared->pendingIndex;
+    pending.pop_back();
+    shared->pendingCache = NULL;
+}
+
+void GLObject::MovePending(GLStateCache* from, GLStateCache* to)
+{
+#ifdef GLFK_THREAD_SAFE_REFS
+    std::lock_guard<std::mutex> lock(s_pendingMutex);
+#endif
+    std::vector<Shared*>& pending = from->_pending;
+    for (unsigned i=0; i<pending.size(); i++) {
+        pending[i]->pendingCache = to;
+        if (to) {
+            pending[i]->pendingIndex = to->_pending.size();
+            to->_pending.push_back(pending[i]);
+        }
+    }
+    pending.clear();
+}
+
+void GLObject::ReleasePending()
+{
+    MovePending(&GLStateCache::Current(), NULL);
+}
+
+unsigned GLObject::CreatePending()
+{
+    assert(GLStateCache::IsContextThread()); // GL objects can't be created without a context
+    // under the lock, so loading threads and Resolve() see either the deferred or the created object
+#ifdef GLFK_THREAD_SAFE_REFS
+    std::lock_guard<std::mutex> lock(s_pendingMutex);
+#endif
+    std::vector<Shared*> pending;
+    pending.swap(GLStateCache::Current()._pending);
+    for (unsigned i=0; i<pending.size(); i++) {
+        pending[i]->pendingCache = NULL;
+#ifdef GLFK_THREAD_SAFE_REFS
+        // released by another thread, waiting in the release queue for deletion
+        if (pending[i]->refs.load(std::memory_order_acquire) == 0) {
+            pending[i] = NULL;
+        }
+#endif
+    }
+    
+    // one create call for all objects with the same function and parameter
+    unsigned created = 0;
+    std::vector<Shared*> group;
+    std::vector<GLuint> names;
+    for (unsigned i=0; i<pending.size(); i++) {
+        if (!pending[i]) {
+            continue;
+        }
+        CreateObjectCallback create = pending[i]->create;
+        GLenum param = pending[i]->createParam;
+        group.clear();
+        for (unsigned j=i; j<pending.size(); j++) {
+            if (pending[j] && pending[j]->create == create && pending[j]->createParam == param) {
+                group.push_back(pending[j]);
+                pending[j] = NULL;
+            }
+        }
+        
+        names.resize(group.size());
+        create(param, group.size(), &names[0]);
+        for (unsigned g=0; g<group.size(); g++) {
+            group[g]->obj = names[g];
+            group[g]->create = NULL;
+        }
+        created += group.size();
+    }
+    return created;
+}
+
+// ---------------------------------------------------------------
+
+#ifdef GLFK_THREAD_SAFE_REFS
+void ReleaseQueue::Push(GLObjectShared* shared)
+{
+    // single consumer takes the whole list at once, so pushing needs no protection against ABA
+    GLObjectShared* head = _head.load(std::memory_order_relaxed);
+    do {
+        shared->nextRelease = head;
+    } while (!_head.compare_exchange_weak(head, shared, std::memory_order_release, std::memory_order_relaxed));
+}
+#endif
+
+unsigned ReleaseQueue::Drain()
+{
+    unsigned count = 0;
+#ifdef GLFK_THREAD_SAFE_REFS
+    GLObjectShared* shared = _head.exchange(NULL, std::memory_order_acquire);
+    while (shared) {
+        GLObjectShared* next = shared->nextRelease;
+        GLObject::DeleteShared(shared);
+        shared = next;
+        count++;
+    }
+#endif
+    return count;
+}
+
+// ---------------------------------------------------------------
+
+DeleteQueue::~DeleteQueue()
+{
+    if (_pending > 0) {
+        printf("%s: %u GL names not deleted, call Finish() while the context exists\n", __FUNCTION__, _pending);
+    }
+}
+
+void DeleteQueue::Push(GLuint obj, DeleteFunc1 del1, DeleteFunc2 del2)
+{
+    if (!del1 && !del2) {
+        return;
+    }
+    NameList* list = NULL;
+    for (unsigned i=0; i<_current.size(); i++) {
+        if (_current[i].del1 == del1 && _current[i].del2 == del2) {
+            list = &_current[i];
+            break;
+        }
+    }
+    if (!list) {
+        _current.push_back(NameList());
+        list = &_current.back();
+        list->del1 = del1;
+        list->del2 = del2;
+    }
+    list->names.push_back(obj);
+    ++_pending;
+}
+
+unsigned DeleteQueue::Delete(NameLists& lists)
+{
+    unsigned count = 0;
+    for (unsigned i=0; i<lists.size(); i++) {
+        std::vector<GLuint>& names = lists[i].names;
+        if (names.empty()) {
+            continue;
+        }
+        if (lists[i].del2) {
+            lists[i].del2(names.size(), &names[0]);
+        } else {
+            for (unsigned n=0; n<names.size(); n++) {
+                lists[i].del1(names[n]);
+            }
+        }
+        count += names.size();
+        names.clear(); // lists are kept for reuse
+    }
+    return count;
+}
+
+void DeleteQueue::EndFrame()
+{
+    if (!_current.empty()) {
+        _batches.push_back(Batch());
+        _batches.back().fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        _batches.back().lists.swap(_current);
+    }
+    
+    // fences signal in order, stop at the first frame still in flight
+    unsigned done = 0;
+    while (done < _batches.size()) {
+        GLenum status = glClientWaitSync(_batches[done].fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        glDeleteSync(_batches[done].fence);
+        _pending -= Delete(_batches[done].lists);
+        done++;
+    }
+    _batches.erase(_batches.begin(), _batches.begin() + done);
+}
+
+void DeleteQueue::Finish()
+{
+    for (unsigned i=0; i<_batches.size(); i++) {
+        glDeleteSync(_batches[i].fence);
+        _pending -= Delete(_batches[i].lists);
+    }
+    _batches.clear();
+    _pending -= Delete(_current);
+    _current.clear();
+}
+
+// ---------------------------------------------------------------
+
+void NamePool::Clear()
+{
+    // with DSA the names are objects already
+    if (!_buffers.empty()) {
+        glDeleteBuffers(_buffers.size(), &_buffers[0]);
+        _buffers.clear();
+    }
+    for (unsigned i=0; i<_textures.size(); i++) {
+        if (!_textures[i].names.empty()) {
+            glDeleteTextures(_textures[i].names.size(), &_textures[i].names[0]);
+        }
+    }
+    _textures.clear();
+}
+
+GLuint NamePool::GenBuffer()
+{
+    if (_buffers.empty()) {
+        _buffers.resize(GLFK_NAME_POOL_BATCH);
+        if (Renderer::HasDirectStateAccess()) {
+            glCreateBuffers(GLFK_NAME_POOL_BATCH, &_buffers[0]);
+        } else {
+            glGenBuffers(GLFK_NAME_POOL_BATCH, &_buffers[0]);
+        }
+    }
+    GLuint name = _buffers.back();
+    _buffers.pop_back();
+    return name;
+}
+
+GLuint NamePool::GenTexture(GLenum target)
+{
+    // generated names are not tied to a target yet, so they share one pool
+    bool dsa = target != 0 && Renderer::HasDirectStateAccess();
+    if (!dsa) {
+        target = 0;
+    }
+    
+    TextureNames* pool = NULL;
+    for (unsigned i=0; i<_textures.size(); i++) {
+        if (_textures[i].target == target) {
+            pool = &_textures[i];
+            break;
+        }
+    }
+    if (!pool) {
+        _textures.push_back(TextureNames());
+        pool = &_textures.back();
+        pool->target = target;
+    }
+    
+    if (pool->names.empty()) {
+        pool->names.resize(GLFK_NAME_POOL_BATCH);
+        if (dsa) {
+            glCreateTextures(target, GLFK_NAME_POOL_BATCH, &pool->names[0]);
+        } else {
+            glGenTextures(GLFK_NAME_POOL_BATCH, &pool->names[0]);
+        }
+    }
+    GLuint name = pool->names.back();
+    pool->names.pop_back();
+    return name;
+}
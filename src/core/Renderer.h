@@ -26,10 +26,28 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 #endif
 
 #include <assert.h>
+#include <vector>
 
 #include "Utils.h"
 #include "Enums.h"
 
+#ifdef GLFK_THREAD_SAFE_REFS
+# ifndef GLFK_HAS_MOVE
+#  error GLFK_THREAD_SAFE_REFS requires C++11
+# endif
+# include <atomic>
+# include <thread>
+#endif
+
+/// Record of indirect indexed draws as read by glMultiDrawElementsIndirect from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
 /// Class encapsulating static functions to general OpenGL commands not bound to any object
 class Renderer
 {
@@ -38,6 +56,26 @@ public:
     static void ClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha);
     static void DrawElements(DrawMode::E mode, GLsizei count, IndicesType::E type, const GLvoid * indices = NULL);
     static void DrawArrays(DrawMode::E mode, GLint first, GLsizei count);
+    static void DrawElementsInstanced(DrawMode::E mode, GLsizei count, IndicesType::E type, const GLvoid * indices,
+                                      GLsizei instances);
+    static void DrawArraysInstanced(DrawMode::E mode, GLint first, GLsizei count, GLsizei instances);
+    static void DrawElementsBaseVertex(DrawMode::E mode, GLsizei count, IndicesType::E type, const GLvoid * indices,
+                                       GLint baseVertex);
+    static void DrawElementsInstancedBaseVertex(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                const GLvoid * indices, GLsizei instances, GLint baseVertex);
+    /// Draw DrawElementsIndirectCommand records from the bound GL_DRAW_INDIRECT_BUFFER, requires HasMultiDrawIndirect()
+    static void MultiDrawElementsIndirect(DrawMode::E mode, IndicesType::E type, const GLvoid * indirect,
+                                          GLsizei drawCount, GLsizei stride = 0);
+    /// Instanced draw with instanced attributes starting at baseInstance, requires HasBaseInstance()
+    static void DrawElementsInstancedBaseInstance(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                  const GLvoid * indices, GLsizei instances, GLuint baseInstance);
+    /// Instanced draw with base vertex and instanced attributes starting at baseInstance, requires HasBaseInstance()
+    static void DrawElementsInstancedBaseVertexBaseInstance(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                            const GLvoid * indices, GLsizei instances,
+                                                            GLint baseVertex, GLuint baseInstance);
+    /// Instanced draw with instanced attributes starting at baseInstance, requires HasBaseInstance()
+    static void DrawArraysInstancedBaseInstance(DrawMode::E mode, GLint first, GLsizei count, GLsizei instances,
+                                                GLuint baseInstance);
     static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
     
     /// Return value of GL integer state variable
@@ -47,60 +85,401 @@ public:
     /// Return value of GL string state variable
     static const char* GetString(GLenum pname);
     
+    /// Detect optional features of the current context. Called by extra/Window after loading GL functions.
+    static void DetectFeatures();
+    
+    /// Returns true if objects are created and modified using Direct State Access (GL 4.5 or ARB_direct_state_access)
+    /// instead of binding them
+    static bool HasDirectStateAccess(){ return s_dsa; };
+    /// Enable or disable the Direct State Access code path (it is enabled by DetectFeatures() when supported).
+    /// Must be set before creating any objects, as DSA requires objects created by glCreate*.
+    static void EnableDirectStateAccess(bool enable);
+    
+    /// Returns true if immutable buffer storage (GL 4.4 or ARB_buffer_storage) is available, allowing persistent mapping
+    static bool HasBufferStorage(){ return s_bufferStorage; };
+    /// Returns true if BaseInstance draws (GL 4.2 or ARB_base_instance) are available
+    static bool HasBaseInstance(){ return s_baseInstance; };
+    /// Returns true if glMultiDrawElementsIndirect (GL 4.3 or ARB_multi_draw_indirect) is available
+    static bool HasMultiDrawIndirect(){ return s_multiDrawIndirect; };
+    /// Returns true if linked programs can be saved and restored (GL 4.1 or ARB_get_program_binary) in some format
+    static bool HasProgramBinary(){ return s_programBinary; };
+    /// Returns true if shaders compile in driver threads (KHR/ARB_parallel_shader_compile), allowing to poll completion
+    static bool HasParallelShaderCompile(){ return s_parallelShaderCompile; };
+    /// Returns true if separable programs and program pipelines (GL 4.1 or ARB_separate_shader_objects) are available.
+    /// Program uniform setters use glProgramUniform* then, without binding the program.
+    static bool HasSeparateShaderObjects(){ return s_separateShaderObjects; };
+    /// Set number of driver threads compiling shaders, 0 disables parallel compile, ~0u lets the driver choose
+    static void SetMaxShaderCompilerThreads(unsigned count);
+    
     // helpers
     static unsigned GetMaxTextureUnits();
+    /// Returns size of one index of the type in bytes
+    static unsigned GetIndexSize(IndicesType::E type);
+    
+private:
+    static bool s_dsa;
+    static bool s_bufferStorage;
+    static bool s_baseInstance;
+    static bool s_multiDrawIndirect;
+    static bool s_programBinary;
+    static bool s_parallelShaderCompile;
+    static bool s_separateShaderObjects;
 };
 /// Shortcut to Renderer
 typedef Renderer R;
 
 // ---------------------------------------------------------------
 
+/// Number of texture units tracked by GLStateCache, binds to higher units are never skipped
+#ifndef GLFK_STATE_CACHE_TEXTURE_UNITS
+# define GLFK_STATE_CACHE_TEXTURE_UNITS 32
+#endif
+
+/** Per-context queue of GL object names released while the GPU may still use them (GLFK_BATCH_GL_NAMES)
+
+Names released during a frame are tagged with a fence by EndFrame() and deleted once the GPU passed the fence,
+using one glDelete* call per object type. Objects without a batched delete (programs, shaders) are deleted
+one by one at the same time.
+*/
+class DeleteQueue : public NoCopy
+{
+public:
+    typedef void(*DeleteFunc1)(GLuint obj);
+    typedef void(*DeleteFunc2)(GLsizei n, const GLuint* ptr);
+    
+    DeleteQueue() : _pending(0) {};
+    /// Doesn't call GL, names still queued go away together with the context
+    ~DeleteQueue();
+    
+    /// Queue the name for deletion by one of the functions
+    void Push(GLuint obj, DeleteFunc1 del1, DeleteFunc2 del2);
+    /// Fence names released since the last call and delete names of frames the GPU finished
+    void EndFrame();
+    /// Delete all queued names without waiting for the GPU, e.g. before destroying the context
+    void Finish();
+    
+    /// Returns number of names waiting for deletion
+    unsigned GetPendingCount()const{ return _pending; };
+    
+private:
+    /// Names deleted by the same function
+    struct NameList {
+        DeleteFunc1 del1;
+        DeleteFunc2 del2;
+        std::vector<GLuint> names;
+    };
+    typedef std::vector<NameList> NameLists;
+    /// Names released in one frame
+    struct Batch {
+        GLsync fence;
+        NameLists lists;
+    };
+    
+    /// Deletes the names and returns their count
+    static unsigned Delete(NameLists& lists);
+    
+    NameLists _current;
+    std::vector<Batch> _batches; ///< oldest first
+    unsigned _pending;
+};
+
+struct GLObjectShared;
+
+/** Lock-free queue of objects whose last reference was released off the thread of their context (GLFK_THREAD_SAFE_REFS)
+
+Any thread can push, only the thread of the context drains the queue and deletes the objects.
+Objects are linked through their reference count blocks, pushing doesn't allocate.
+*/
+class ReleaseQueue : public NoCopy
+{
+public:
+#ifdef GLFK_THREAD_SAFE_REFS
+    ReleaseQueue() : _head(NULL) {};
+    
+    /// Queue the object, callable from any thread
+    void Push(GLObjectShared* shared);
+#endif
+    /// Delete objects released by other threads, call it on the thread of the context. Returns their count.
+    unsigned Drain();
+    
+private:
+#ifdef GLFK_THREAD_SAFE_REFS
+    std::atomic<GLObjectShared*> _head;
+#endif
+};
+
+/// Number of names generated at once by NamePool
+#ifndef GLFK_NAME_POOL_BATCH
+# define GLFK_NAME_POOL_BATCH 32
+#endif
+
+/** Per-context pool of unused buffer and texture names generated in batches (GLFK_BATCH_GL_NAMES)
+
+Released names are not recycled, they go to DeleteQueue: a deleted name frees the storage of the object,
+while a recycled one would keep it (and DSA names are bound to their target). The pool only saves GL calls.
+*/
+class NamePool : public NoCopy
+{
+public:
+    /// Delete the names left in the pool, call it while the context exists (extra/Window does)
+    void Clear();
+    /// Returns new buffer name, created by glCreateBuffers with Direct State Access
+    GLuint GenBuffer();
+    /// Returns new texture name, created for the target with Direct State Access. Target 0 only generates the name.
+    GLuint GenTexture(GLenum target);
+    
+private:
+    /// Names of textures, created for the target with Direct State Access
+    struct TextureNames {
+        GLenum target;
+        std::vector<GLuint> names;
+    };
+    
+    std::vector<GLuint> _buffers;
+    std::vector<TextureNames> _textures;
+};
+
+/** Object bindings of a single GL context, used to skip redundant binds (GLFK_PREVENT_MULTIPLE_BIND)
+
+Bindings are stored in flat arrays indexed by a compact target id, texture bindings are tracked per texture unit.
+Each context should have its own cache made current together with the context (extra/Window does that).
+With GLFK_THREAD_SAFE_REFS the current cache is per thread, like the current GL context. Threads which didn't
+make any cache current use the first one made current, so objects of loading threads belong to the main context.
+*/
+class GLStateCache : public NoCopy
+{
+    friend class GLObject;
+    
+public:
+    GLStateCache();
+    /// Objects waiting for creation are taken off the pending list. With GLFK_THREAD_SAFE_REFS objects owned by the
+    /// cache are handed to the default cache, their GL objects went with the context.
+    ~GLStateCache();
+
+    /// Returns the cache of the current context
+#ifdef GLFK_THREAD_SAFE_REFS
+    static GLStateCache& Current(){ return s_threadCurrent ? *s_threadCurrent : *s_current; };
+#else
+    static GLStateCache& Current(){ return *s_current; };
+#endif
+    /// Make the cache current. NULL selects the default cache used when no context registered its own.
+    /// With GLFK_THREAD_SAFE_REFS the first cache made current takes over objects owned by the default cache.
+    static void MakeCurrent(GLStateCache* cache);
+    /// Returns the cache used when no context registered its own. Objects released by other threads before a
+    /// context existed, or after it was destroyed, wait in its ReleaseQueue.
+    static GLStateCache& GetDefault();
+    /// Returns true if the calling thread may create GL objects. With GLFK_THREAD_SAFE_REFS that is a thread which
+    /// made a cache current together with its context (extra/Window does that), otherwise it's assumed to be.
+#ifdef GLFK_THREAD_SAFE_REFS
+    static bool IsContextThread(){ return s_threadCurrent != NULL; };
+#else
+    static bool IsContextThread(){ return true; };
+#endif
+
+    /// Forget all bindings. Call it after binding objects using GL functions directly.
+    void Invalidate();
+    /// Forget every binding of the object name (GL unbinds objects being deleted)
+    void Forget(GLuint obj);
+    /// Forget binding of the target, e.g. after changing element buffer of a VAO using DSA
+    void ForgetBuffer(GLenum target);
+
+    // Setters record the new binding and return false if the object was bound already
+    bool SetBuffer(GLenum target, GLuint buffer);
+    bool SetActiveTexture(unsigned unit);
+    /// Records texture binding for the active texture unit
+    bool SetTexture(GLenum target, GLuint texture);
+    /// Records texture binding for the specified texture unit
+    bool SetTexture(unsigned unit, GLenum target, GLuint texture);
+    bool SetFramebuffer(GLenum target, GLuint framebuffer);
+    bool SetRenderbuffer(GLuint renderbuffer);
+    bool SetVertexArray(GLuint array);
+    bool SetProgram(GLuint program);
+    bool SetProgramPipeline(GLuint pipeline);
+
+    unsigned GetActiveTexture()const{ return _activeUnit; };
+    
+    /// Names released by objects of the context, waiting for the GPU
+    DeleteQueue& GetDeleteQueue(){ return _deleteQueue; };
+    /// Unused names of the context
+    NamePool& GetNamePool(){ return _namePool; };
+    /// Objects released by other threads, waiting for the thread of the context
+    ReleaseQueue& GetReleaseQueue(){ return _releaseQueue; };
+#ifdef GLFK_THREAD_SAFE_REFS
+    /// Returns true if called from the thread which made the cache current last
+    bool IsOwnerThread()const{ return _thread.load(std::memory_order_relaxed) == std::this_thread::get_id(); };
+#endif
+
+private:
+    enum {
+        NUM_BUFFER_TARGETS = 14,
+        NUM_TEXTURE_TARGETS = 11,
+        NUM_FRAMEBUFFER_TARGETS = 2, // draw, read
+    };
+    static const GLuint UNKNOWN = ~0u;
+    static GLStateCache* s_current;
+#ifdef GLFK_THREAD_SAFE_REFS
+    static thread_local GLStateCache* s_threadCurrent;
+#endif
+
+    static int BufferTargetIndex(GLenum target);
+    static int TextureTargetIndex(GLenum target);
+
+    GLuint _buffers[NUM_BUFFER_TARGETS];
+    GLuint _textures[GLFK_STATE_CACHE_TEXTURE_UNITS][NUM_TEXTURE_TARGETS];
+    GLuint _framebuffers[NUM_FRAMEBUFFER_TARGETS];
+    GLuint _renderbuffer;
+    GLuint _array;
+    GLuint _program;
+    GLuint _pipeline;
+    unsigned _activeUnit;
+    
+    DeleteQueue _deleteQueue;
+    NamePool _namePool;
+    ReleaseQueue _releaseQueue;
+    /// Deferred objects waiting for GLObject::CreatePending, without a reference. Objects are taken off the list
+    /// when they are created or deleted.
+    std::vector<GLObjectShared*> _pending;
+#ifdef GLFK_THREAD_SAFE_REFS
+    /// Written by MakeCurrent, read by threads releasing objects of the cache
+    std::atomic<std::thread::id> _thread;
+#endif
+};
+
+// ---------------------------------------------------------------
+
 /// Print refence counting done with GLObject
 #ifdef GLFK_DEBUG_REF_COUNTING
 # include <stdio.h>
 #endif
 
-/// Class holding a reference counted GL object (OpenGL classes holding a GL objects derives from this)
+/// Data attached to a GL object and shared by all copies of the GLObject, deleted together with the GL object
+class GLObjectData
+{
+public:
+    virtual ~GLObjectData(){};
+};
+
+/// Reference count, the GL object and data shared by all copies of a GLObject
+struct GLObjectShared {
+#ifdef GLFK_THREAD_SAFE_REFS
+    std::atomic<unsigned> refs;
+    /// Cache of the context which deletes the object, changed when the cache goes away
+    std::atomic<GLStateCache*> owner;
+    GLObjectShared* nextRelease;
+    /// Read by IsCreated() on any thread
+    std::atomic<GLuint> obj;
+#else
+    unsigned refs;
+    GLuint obj;
+#endif
+    void(*del1)(GLuint obj);
+    void(*del2)(GLsizei n, const GLuint* ptr);
+    /// Creates names of n objects of the type, set until the object of a deferred GLObject is created
+    void(*create)(GLenum param, GLsizei n, GLuint* names);
+    GLenum createParam;
+    /// Cache whose pending list holds the block at pendingIndex, NULL if not listed
+    GLStateCache* pendingCache;
+    unsigned pendingIndex;
+    union {
+        GLObjectData* data;
+        GLObjectShared* nextFree; ///< next free block while in the pool
+    };
+};
+
+/** Class holding a reference counted GL object (OpenGL classes holding a GL objects derives from this)
+
+Copies share the GL object and its GLObjectData. Reference counts are allocated from a slab pool rather than
+one by one.
+
+Constructors don't call GL, the GL object is created in the current context when the object is used first, or
+together with the other objects waiting for creation by CreatePending, using one glGen or glCreate call per object
+type. Wrappers can thus be constructed before a context exists, e.g. by a loading thread (with GLFK_THREAD_SAFE_REFS),
+and created in a batch by the GL thread. Using an object, e.g. setting its data, needs the context.
+
+With GLFK_BATCH_GL_NAMES defined, the GL object is deleted by DeleteQueue of the context after the GPU
+finished the frame, and buffers and textures take their names from NamePool.
+With GLFK_THREAD_SAFE_REFS defined, reference counts are atomic so copies can be held and dropped by other threads.
+When the last copy goes away on another thread, the object is deleted later by the thread of its context,
+see ReleaseQueue. Otherwise objects must be released on the thread of the GL context.
+With C++11 objects can be moved without touching the reference count, which every derived class inherits.
+*/
 class GLObject
 {
+    friend class ReleaseQueue;
+    friend class GLStateCache;
+    
 protected:
     typedef void(*DeleteObjectCallbackType1)(GLuint obj);
     typedef void(*DeleteObjectCallbackType2)(GLsizei n, const GLuint* ptr);
+    /// Creates names of n objects, param is e.g. the texture target or the shader type
+    typedef void(*CreateObjectCallback)(GLenum param, GLsizei n, GLuint* names);
+    
+    /// Tag of the constructor of an object without a GL object, e.g. the default framebuffer
+    struct NoObject {};
     
     /// Default constructor
-    GLObject() : _refs(new unsigned(1)), _del1(NULL), _del2(NULL), _obj(0) {
+    GLObject() : _shared(AllocShared()), _obj(0) {
 #ifdef GLFK_DEBUG_REF_COUNTING
         printf("%p: new GLObject\n", this);
 #endif
     };
+    /// Object which never gets a GL object, name 0 is used
+    GLObject(NoObject) : _shared(NULL), _obj(0) {};
     
     /// Copy constructor
-    GLObject(const GLObject& other) : _refs(other._refs), _del1(other._del1), _del2(other._del2), _obj(other._obj) {
+    GLObject(const GLObject& other) : _shared(other._shared), _obj(other._obj) {
 #ifdef GLFK_DEBUG_REF_COUNTING
         printf("%p: copy with obj %u\n", this, _obj);
 #endif
         Retain(); };
-    ~GLObject(){ if (_obj>0) Release(); };
+    ~GLObject(){ Release(); };
     
     /// Copy operator
     GLObject& operator=(const GLObject& other){
         if (this != &other){
 #ifdef GLFK_DEBUG_REF_COUNTING
             printf("%p: assigning obj %u from other GLObject %p\n", this, _obj, &other);
+#endif
+            GLObject copy(other); // retain first, releasing may drop the last reference of other
+            Release();
+            _obj = copy._obj;
+            _shared = copy._shared;
+            copy._shared = NULL;
+        }
+        return *this;
+    }
+    
+#ifdef GLFK_HAS_MOVE
+    /// Move constructor, the other object is left empty
+    GLObject(GLObject&& other) GLFK_NOEXCEPT : _shared(other._shared), _obj(other._obj) {
+#ifdef GLFK_DEBUG_REF_COUNTING
+        printf("%p: move with obj %u\n", this, _obj);
+#endif
+        other._shared = NULL;
+        other._obj = 0;
+    };
+    
+    /// Move operator, the other object is left empty
+    GLObject& operator=(GLObject&& other) GLFK_NOEXCEPT {
+        if (this != &other){
+#ifdef GLFK_DEBUG_REF_COUNTING
+            printf("%p: moving obj %u from other GLObject %p\n", this, _obj, &other);
 #endif
             Release();
             _obj = other._obj;
-            _refs = other._refs;
-            Retain();
+            _shared = other._shared;
+            other._shared = NULL;
+            other._obj = 0;
         }
         return *this;
     }
+#endif
     
     /// Assign a OpenGL object and associated OpenGL Delete function. Can be called one time only.
     GLObject& AssignGLObject(GLuint obj, DeleteObjectCallbackType1 del1) {
-        assert(_obj == 0); // assign called second time
-        _obj = obj;
-        _del1 = del1;
+        assert(_shared && _shared->obj == 0 && !_shared->create); // assign called second time
+        _obj = _shared->obj = obj;
+        _shared->del1 = del1;
 #ifdef GLFK_DEBUG_REF_COUNTING
         printf("%p: assigned obj %u\n", this, _obj);
 #endif
@@ -108,52 +487,125 @@ protected:
     }
     /// Assign a OpenGL object and associated OpenGL Delete function. Can be called one time only.
     GLObject& AssignGLObject(GLuint obj, DeleteObjectCallbackType2 del2) {
-        assert(_obj == 0); // assign called second time
-        _obj = obj;
-        _del2 = del2;
+        assert(_shared && _shared->obj == 0 && !_shared->create); // assign called second time
+        _obj = _shared->obj = obj;
+        _shared->del2 = del2;
 #ifdef GLFK_DEBUG_REF_COUNTING
         printf("%p: assigned obj %u\n", this, _obj);
 #endif
         return *this;
     }
     
+    /// Create the OpenGL object on first use or by CreatePending(). Can be called one time only, instead of AssignGLObject.
+    GLObject& DeferGLObject(CreateObjectCallback create, GLenum param, DeleteObjectCallbackType1 del1) {
+        _shared->del1 = del1;
+        return DeferGLObject(create, param);
+    }
+    /// Create the OpenGL object on first use or by CreatePending(). Can be called one time only, instead of AssignGLObject.
+    GLObject& DeferGLObject(CreateObjectCallback create, GLenum param, DeleteObjectCallbackType2 del2) {
+        _shared->del2 = del2;
+        return DeferGLObject(create, param);
+    }
+    
+    /// Returns data shared by all copies of this object, NULL if not set
+    GLObjectData* GetSharedData()const{ return _shared ? _shared->data : NULL; };
+    /// Attach data shared by all copies of this object, deleting the previous data
+    void SetSharedData(GLObjectData* data){
+        assert(_shared); // moved-from object
+        delete _shared->data;
+        _shared->data = data;
+    };
+    
     /// Retain this object, incrementing reference count
-    GLObject& Retain(){ ++*_refs; return *this; };
+    GLObject& Retain(){
+        if (_shared) {
+            RetainShared(_shared);
+        }
+        return *this;
+    };
     
-    /// Release this object, decrementing reference count
+    /// Release this object, decrementing reference count. Does nothing for a moved-from object.
     GLObject& Release(){
-        assert(*_refs > 0); // attempt to release a released object
-        if (*_refs == 1) {
-#ifdef GLFK_DEBUG_REF_COUNTING
-            printf("%p: deleting obj %u using %p or %p\n", this, _obj, _del1, _del2);
-#endif
-            if (_del1) {
-                _del1(_obj);
-            } else if (_del2) {
-                _del2(1, &_obj);
-            }
-            _obj = 0;
-            delete _refs;
-            return *this;
+        if (_shared) {
+            ReleaseShared(_shared);
         }
-        --*_refs;
+        _shared = NULL;
+        _obj = 0;
         return *this;
     };
     
 public:
     
-    /// Returns the stored GL object 
-    operator GLuint()const{ return _obj; }
+    /// Returns the stored GL object, creating it if it was deferred
+    operator GLuint()const{ return _obj ? _obj : Resolve(); }
+    
+    /// Returns current reference count, 0 for a moved-from object
+    unsigned RefCount()const{ return _shared ? (unsigned)_shared->refs : 0; };
+    
+    /// Returns true if the GL object was created already
+    bool IsCreated()const{ return _obj || (_shared && _shared->obj); };
+    
+    /// Give up ownership of the GL object without deleting it, e.g. to hand it over to a ResourceRegistry.
+    /// Must be the only reference. Returns the name and leaves this object empty, shared data is deleted.
+    /// Returns 0 and leaves the object untouched if other copies exist, they would delete the object.
+    GLuint Detach(){
+        if (RefCount() != 1) {
+            return 0;
+        }
+        GLuint obj = *this;
+        _shared->del1 = NULL;
+        _shared->del2 = NULL;
+        Release();
+        return obj;
+    };
     
-    /// Returns current reference count
-    unsigned RefCount()const{ return *_refs; };
+    /// Create GL objects of all objects constructed for the current context so far, using one glGen or glCreate call
+    /// per object type. Call it on the GL thread, e.g. after loading a level. Returns number of created objects.
+    static unsigned CreatePending();
+    /// Drop the pending objects of the current context without creating them, e.g. before destroying the context.
+    /// Objects still referenced are created by the context which uses them first.
+    static void ReleasePending();
     
 private:
-    unsigned *_refs;
-    DeleteObjectCallbackType1 _del1;
-    DeleteObjectCallbackType2 _del2;
+    typedef GLObjectShared Shared;
+    
+    GLObject& DeferGLObject(CreateObjectCallback create, GLenum param);
+    /// Returns the object of the shared data, creating it in the current context if needed
+    GLuint Resolve()const;
+    /// Move the pending list of one cache to another, NULL drops the list
+    static void MovePending(GLStateCache* from, GLStateCache* to);
+    /// Take the block off its pending list, the caller holds the pending list lock
+    static void UnlinkPending(Shared* shared);
+    
+    /// Returns a block with refs 1 and no data from the pool
+    static Shared* AllocShared();
+    /// Returns the block into the pool
+    static void FreeShared(Shared* shared);
+    static void RetainShared(Shared* shared){
+#ifdef GLFK_THREAD_SAFE_REFS
+        shared->refs.fetch_add(1, std::memory_order_relaxed);
+#else
+        ++shared->refs;
+#endif
+    }
+    /// Decrements reference count, deleting the object (or queueing it for the thread of its context) if it was the last
+    static void ReleaseShared(Shared* shared);
+    /// Deletes the GL object and the shared data, and frees the block. Called on the thread of the context.
+    static void DeleteShared(Shared* shared);
+    /// Free blocks linked through nextFree, slabs are never returned to the heap
+    static Shared* s_freeShared;
+#ifdef GLFK_THREAD_SAFE_REFS
+    /// Hand blocks owned by one cache to another. With dropObjects the GL objects aren't deleted anymore,
+    /// as they went away with their context.
+    static void RehomeShared(GLStateCache* from, GLStateCache* to, bool dropObjects);
+    /// All slabs, for RehomeShared
+    static std::vector<Shared*> s_slabs;
+#endif
+    
+    Shared *_shared;
 protected:
-    GLuint _obj;
+    /// Cached name of the object, 0 until created
+    mutable GLuint _obj;
 };
 
 // useful macros -------------------------------------------------
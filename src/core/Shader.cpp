@@ -5,40 +5,145 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 #include "Shader.h"
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
+#include <algorithm>
 
 #ifdef GLFK_HAS_GLM
 # include <glm/gtc/type_ptr.hpp>
 #endif
 
+/// Creates shaders deferred by the constructor, there is no batched variant
+static void CreateShaders(GLenum shaderType, GLsizei n, GLuint* names)
+{
+    for (GLsizei i=0; i<n; i++) {
+        names[i] = glCreateShader(shaderType);
+    }
+}
+
 BaseShader::BaseShader(GLenum shaderType) 
-: _valid(false)
 {
-    AssignGLObject(glCreateShader(shaderType), glDeleteShader);
+    DeferGLObject(CreateShaders, shaderType, glDeleteShader);
 }
-BaseShader::BaseShader(GLenum shaderType, std::string source)
-: _valid(false)
+BaseShader::BaseShader(GLenum shaderType, const std::string& source)
 {
-    AssignGLObject(glCreateShader(shaderType), glDeleteShader);
+    DeferGLObject(CreateShaders, shaderType, glDeleteShader);
     SetSource(source);
 }
-BaseShader& BaseShader::SetSource(std::string str)
+BaseShader::ShaderData* BaseShader::GetShaderData()
+{
+    ShaderData* data = (ShaderData*)GetSharedData();
+    if (!data) {
+        data = new ShaderData;
+        SetSharedData(data);
+    }
+    return data;
+}
+BaseShader& BaseShader::SetSource(const std::string& str)
 {
-    if (str.length() == 0) 
+    ShaderSourceView view(str);
+    return SetSource(&view, 1);
+}
+BaseShader& BaseShader::SetSource(const ShaderSourceView* views, unsigned count)
+{
+    // pointers and lengths must be passed in separate arrays, avoid allocating them for common counts
+    enum { MAX_STACK_VIEWS = 16 };
+    const GLchar* stackPtrs[MAX_STACK_VIEWS];
+    GLint stackLengths[MAX_STACK_VIEWS];
+    std::vector<const GLchar*> heapPtrs;
+    std::vector<GLint> heapLengths;
+    const GLchar** ptrs = stackPtrs;
+    GLint* lengths = stackLengths;
+    if (count > MAX_STACK_VIEWS) {
+        heapPtrs.resize(count);
+        heapLengths.resize(count);
+        ptrs = &heapPtrs[0];
+        lengths = &heapLengths[0];
+    }
+    
+    // the new source needs compiling, also by programs attaching the shader later
+    ShaderData* data = GetShaderData();
+    data->compiled = false;
+    data->valid = false;
+    
+    if (!IsCreated() && !GLStateCache::IsContextThread()) {
+        // keep a copy until the shader is created, the views may be gone by then
+        data->source.clear();
+        for (unsigned i = 0; i < count; i++) {
+            if (views[i].data) {
+                data->source.append(views[i].data, views[i].length < 0 ? strlen(views[i].data) : views[i].length);
+            }
+        }
+        if (data->source.empty()) {
+            printf("%s: empty source!\n", __FUNCTION__);
+        }
+        data->sourcePending = true;
+        return *this;
+    }
+    
+    bool empty = true;
+    for (unsigned i = 0; i < count; i++) {
+        ptrs[i] = views[i].data ? views[i].data : "";
+        lengths[i] = views[i].data ? views[i].length : 0;
+        empty = empty && lengths[i] == 0;
+    }
+    if (empty) {
         printf("%s: empty source!\n", __FUNCTION__);
-
-    const char* ptr = str.c_str();
-    glShaderSource(*this, 1, &ptr, NULL);
+    }
+    
+    glShaderSource(*this, count, ptrs, lengths);
     return *this;
 }
+BaseShader& BaseShader::SetSourceFile(const char* path)
+{
+    MappedFile file(path);
+    if (!file.IsValid()) {
+        printf("%s: unable to read %s\n", __FUNCTION__, path);
+    }
+    ShaderSourceView view(file);
+    return SetSource(&view, 1);
+}
 bool BaseShader::Compile()
 {
+    CompileAsync();
+    return FinishCompile();
+}
+void BaseShader::UploadSource()
+{
+    ShaderData* data = (ShaderData*)GetSharedData();
+    if (!data || !data->sourcePending) {
+        return;
+    }
+    GLuint shader = *this; // creates the shader, so SetSource passes the source to GL
+    (void)shader;
+    ShaderSourceView view(data->source);
+    SetSource(&view, 1);
+    data->sourcePending = false;
+    std::string().swap(data->source);
+}
+BaseShader& BaseShader::CompileAsync()
+{
+    UploadSource();
     glCompileShader(*this);
-
+    GetShaderData()->compiled = true;
+    return *this;
+}
+bool BaseShader::IsReady()const
+{
+    if (!Renderer::HasParallelShaderCompile()) {
+        return true;
+    }
+    GLint done = GL_TRUE;
+    glGetShaderiv(*this, GL_COMPLETION_STATUS_ARB, &done);
+    return done != GL_FALSE;
+}
+bool BaseShader::FinishCompile()
+{
     GLint success = 0;
     glGetShaderiv(*this, GL_COMPILE_STATUS, &success);
 
-    _valid = success != GL_FALSE;
-    return _valid;
+    ShaderData* data = GetShaderData();
+    data->valid = success != GL_FALSE;
+    return data->valid;
 }
 std::string BaseShader::GetInfoLog()const
 {
@@ -58,53 +163,184 @@ std::string BaseShader::GetInfoLog()const
 
 //----------------------------------------------------------------------------
 
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-GLuint Program::s_boundProgram = 0;
-#endif
+/// Header of serialized ProgramReflection
+struct ReflectionHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t numAttributes;
+    uint32_t numUniforms;
+    uint32_t numBlocks;
+    uint32_t namesSize;
+};
+static const uint32_t REFLECTION_VERSION = 1;
+
+template <typename T>
+static int FindByName(const ProgramReflection& reflection, const std::vector<T>& entries, const char* name)
+{
+    for (unsigned i=0; i<entries.size(); i++) {
+        if (!strcmp(reflection.GetName(entries[i].name), name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int ProgramReflection::FindAttribute(const char* name)const
+{
+    return FindByName(*this, attributes, name);
+}
+
+int ProgramReflection::FindUniform(const char* name)const
+{
+    return FindByName(*this, uniforms, name);
+}
+
+int ProgramReflection::FindBlock(const char* name)const
+{
+    return FindByName(*this, blocks, name);
+}
+
+unsigned ProgramReflection::InternName(const char* name, NameOffsets& offsets)
+{
+    std::pair<NameOffsets::iterator, bool> it = offsets.insert(std::make_pair(std::string(name), (unsigned)names.size()));
+    if (it.second) {
+        names.insert(names.end(), name, name + strlen(name) + 1);
+    }
+    return it.first->second;
+}
+
+void ProgramReflection::Clear()
+{
+    attributes.clear();
+    uniforms.clear();
+    blocks.clear();
+    names.clear();
+}
+
+template <typename T>
+static void AppendArray(std::vector<unsigned char>& data, const std::vector<T>& arr)
+{
+    if (!arr.empty()) {
+        const unsigned char* ptr = (const unsigned char*)&arr[0];
+        data.insert(data.end(), ptr, ptr + arr.size() * sizeof(T));
+    }
+}
+
+template <typename T>
+static void ReadArray(const unsigned char*& ptr, std::vector<T>& arr, uint32_t count)
+{
+    arr.resize(count);
+    if (count > 0) {
+        memcpy(&arr[0], ptr, count * sizeof(T));
+        ptr += count * sizeof(T);
+    }
+}
+
+template <typename T>
+static bool NamesInPool(const std::vector<T>& entries, size_t poolSize)
+{
+    for (unsigned i=0; i<entries.size(); i++) {
+        if (entries[i].name >= poolSize) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ProgramReflection::Serialize(std::vector<unsigned char>& data)const
+{
+    ReflectionHeader header = { {'G', 'L', 'F', 'R'}, REFLECTION_VERSION,
+        (uint32_t)attributes.size(), (uint32_t)uniforms.size(), (uint32_t)blocks.size(), (uint32_t)names.size() };
+    const unsigned char* ptr = (const unsigned char*)&header;
+    data.insert(data.end(), ptr, ptr + sizeof(header));
+    AppendArray(data, attributes);
+    AppendArray(data, uniforms);
+    AppendArray(data, blocks);
+    AppendArray(data, names);
+}
+
+bool ProgramReflection::Deserialize(const unsigned char* data, size_t size)
+{
+    ReflectionHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, "GLFR", 4) || header.version != REFLECTION_VERSION) {
+        return false;
+    }
+    uint64_t expected = sizeof(header) + (uint64_t)header.numAttributes * sizeof(Attribute)
+        + (uint64_t)header.numUniforms * sizeof(Uniform) + (uint64_t)header.numBlocks * sizeof(UniformBlock)
+        + header.namesSize;
+    if (size != expected || (header.namesSize > 0 && data[size - 1] != '\0')) {
+        return false;
+    }
+    
+    const unsigned char* ptr = data + sizeof(header);
+    ReadArray(ptr, attributes, header.numAttributes);
+    ReadArray(ptr, uniforms, header.numUniforms);
+    ReadArray(ptr, blocks, header.numBlocks);
+    ReadArray(ptr, names, header.namesSize);
+    
+    // reject name offsets outside of the pool
+    if (!NamesInPool(attributes, names.size()) || !NamesInPool(uniforms, names.size())
+        || !NamesInPool(blocks, names.size())) {
+        Clear();
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+
+/// Creates programs deferred by the constructor, there is no batched variant
+static void CreatePrograms(GLenum, GLsizei n, GLuint* names)
+{
+    for (GLsizei i=0; i<n; i++) {
+        names[i] = glCreateProgram();
+    }
+}
 
 Program::Program()
-: _valid(false)
 {
-    AssignGLObject(glCreateProgram(), glDeleteProgram);
+    DeferGLObject(CreatePrograms, 0, glDeleteProgram);
+}
+Program::Program(GLuint program)
+{
+    AssignGLObject(program, glDeleteProgram);
 }
 Program::Program(BaseShader& sh)
-: _valid(false)
 {
-    AssignGLObject(glCreateProgram(), glDeleteProgram);
+    DeferGLObject(CreatePrograms, 0, glDeleteProgram);
     AttachShader(sh);
 }
 Program::Program(BaseShader& sh1, BaseShader& sh2)
-: _valid(false)
 {
-    AssignGLObject(glCreateProgram(), glDeleteProgram);
+    DeferGLObject(CreatePrograms, 0, glDeleteProgram);
     AttachShader(sh1);
     AttachShader(sh2);
 }
 Program::Program(BaseShader& sh1, BaseShader& sh2, BaseShader& sh3)
-: _valid(false)
 {
-    AssignGLObject(glCreateProgram(), glDeleteProgram);
+    DeferGLObject(CreatePrograms, 0, glDeleteProgram);
     AttachShader(sh1);
     AttachShader(sh2);
     AttachShader(sh3);
 }
 Program::Program(const BaseShader& sh)
-: _valid(false)
 {
-    AssignGLObject(glCreateProgram(), glDeleteProgram);
+    DeferGLObject(CreatePrograms, 0, glDeleteProgram);
     AttachShader(sh);
 }
 Program::Program(const BaseShader& sh1, const BaseShader& sh2)
-: _valid(false)
 {
-    AssignGLObject(glCreateProgram(), glDeleteProgram);
+    DeferGLObject(CreatePrograms, 0, glDeleteProgram);
     AttachShader(sh1);
     AttachShader(sh2);
 }
 Program::Program(const BaseShader& sh1, const BaseShader& sh2, const BaseShader& sh3)
-: _valid(false)
 {
-    AssignGLObject(glCreateProgram(), glDeleteProgram);
+    DeferGLObject(CreatePrograms, 0, glDeleteProgram);
     AttachShader(sh1);
     AttachShader(sh2);
     AttachShader(sh3);
@@ -112,28 +348,510 @@ Program::Program(const BaseShader& sh1, const BaseShader& sh2, const BaseShader&
 
 Program& Program::AttachShader(BaseShader& sh)
 {
-    if (!sh.IsValid())
-        sh.Compile();
+    // a copy compiled the shader already, programs share its compile status
+    if (!sh.IsCompiled()) {
+        GetData()->pendingShaders.push_back(sh);
+    }
     
+    if (!IsCreated()) {
+        GetData()->deferredShaders.push_back(sh);
+        return *this;
+    }
+    // the source is read back by GetSourceHash
+    sh.UploadSource();
     glAttachShader(*this, sh);
     return *this;
 }
 
 Program& Program::AttachShader(const BaseShader& sh)
 {
+    if (!IsCreated()) {
+        GetData()->deferredShaders.push_back(sh);
+        return *this;
+    }
+    // copies share the source, so the shader itself doesn't change
+    BaseShader(sh).UploadSource();
     glAttachShader(*this, sh);
     return *this;
 }
 
+void Program::ApplyDeferred()
+{
+    LinkData* data = (LinkData*)GetSharedData();
+    if (!data || (data->deferredShaders.empty() && !data->deferredBindings)) {
+        return;
+    }
+    // sources set by loading threads go to GL first, GetSourceHash reads them back
+    for (unsigned i=0; i<data->deferredShaders.size(); i++) {
+        data->deferredShaders[i].UploadSource();
+        glAttachShader(*this, data->deferredShaders[i]);
+    }
+    data->deferredShaders.clear();
+    
+    if (data->deferredBindings) {
+        for (unsigned i=0; i<data->attribBindings.size(); i++) {
+            glBindAttribLocation(*this, data->attribBindings[i].first, data->attribBindings[i].second.c_str());
+        }
+        data->deferredBindings = false;
+    }
+}
+
 bool Program::Link()
 {
+    LinkAsync();
+    return FinishLink();
+}
+
+Program& Program::LinkAsync()
+{
+    LinkData* data = GetData();
+    for (unsigned i=0; i<data->pendingShaders.size(); i++) {
+        data->pendingShaders[i].CompileAsync();
+    }
+    ApplyDeferred();
+    // keep the shaders until FinishLink to report their compile errors
+    data->compilingShaders.swap(data->pendingShaders);
+    data->pendingShaders.clear();
+    
     glLinkProgram(*this);
+    
+    data->linked = false;
+    data->linkPending = true;
+    return *this;
+}
+
+bool Program::IsReady()const
+{
+    const LinkData* data = (const LinkData*)GetSharedData();
+    if (!data || !data->linkPending || !Renderer::HasParallelShaderCompile()) {
+        return true;
+    }
+    return GetInt(GL_COMPLETION_STATUS_ARB) != GL_FALSE;
+}
 
+bool Program::FinishLink()
+{
+    LinkData* data = GetData();
+    if (!data->linkPending) {
+        return IsValid();
+    }
+    data->linkPending = false;
+    
     GLint success = 0;
     glGetProgramiv(*this, GL_LINK_STATUS, &success);
+    
+    if (success == GL_FALSE) {
+        for (unsigned i=0; i<data->compilingShaders.size(); i++) {
+            BaseShader& sh = data->compilingShaders[i];
+            if (!sh.FinishCompile()) {
+                std::string log = sh.GetInfoLog();
+                printf("%s: shader failed to compile: %s\n", __FUNCTION__, log.c_str());
+            }
+        }
+    }
+    if (success != GL_FALSE) {
+        // linking succeeded, so did compiling
+        for (unsigned i=0; i<data->compilingShaders.size(); i++) {
+            data->compilingShaders[i].GetShaderData()->valid = true;
+        }
+    }
+    data->compilingShaders.clear();
+    
+    if (success != GL_FALSE) {
+        BuildLinkData();
+    }
+    
+    return IsValid();
+}
+
+bool Program::ProgramBinary(GLenum format, const void* binary, GLsizei length)
+{
+    glProgramBinary(*this, format, binary, length);
+    
+    LinkData* data = GetData();
+    data->linked = false;
+    data->linkPending = false;
+    if (GetInt(GL_LINK_STATUS) != GL_FALSE) {
+        data->pendingShaders.clear();
+        BuildLinkData();
+    }
+    
+    return IsValid();
+}
 
-    _valid = success != GL_FALSE;
-    return _valid;
+bool Program::GetProgramBinary(std::vector<unsigned char>& binary, GLenum& format)const
+{
+    GLint length = GetInt(GL_PROGRAM_BINARY_LENGTH);
+    if (length <= 0) {
+        return false;
+    }
+    binary.resize(length);
+    glGetProgramBinary(*this, length, &length, &format, &binary[0]);
+    binary.resize(length);
+    return length > 0;
+}
+
+Program& Program::SetBinaryRetrievable(bool retrievable)
+{
+    glProgramParameteri(*this, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, retrievable ? GL_TRUE : GL_FALSE);
+    return *this;
+}
+
+Program& Program::SetSeparable(bool separable)
+{
+    assert(Renderer::HasSeparateShaderObjects());
+    glProgramParameteri(*this, GL_PROGRAM_SEPARABLE, separable ? GL_TRUE : GL_FALSE);
+    return *this;
+}
+
+Program Program::CreateShaderProgram(GLenum shaderType, const std::string& source)
+{
+    assert(Renderer::HasSeparateShaderObjects());
+    const GLchar* str = source.c_str();
+    Program program(glCreateShaderProgramv(shaderType, 1, &str));
+    
+    // compile errors are appended to the program log
+    if (program.GetInt(GL_LINK_STATUS)) {
+        program.BuildLinkData();
+    } else {
+        std::string log = program.GetInfoLog();
+        printf("%s: program failed to link: %s\n", __FUNCTION__, log.c_str());
+    }
+    return program;
+}
+
+const uint64_t Program::UNCACHEABLE;
+
+uint64_t Program::GetSourceHash()
+{
+    ApplyDeferred();
+    GLint num = GetInt(GL_ATTACHED_SHADERS);
+    std::vector<GLuint> shaders(num);
+    if (num > 0) {
+        glGetAttachedShaders(*this, num, &num, &shaders[0]);
+    }
+    
+    // attachment order reported by GL is not defined, so combine per-shader hashes order-independently
+    uint64_t shadersHash = 0;
+    std::vector<char> source;
+    for (GLint i=0; i<num; i++) {
+        GLint type, length;
+        glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+        glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length);
+        source.resize(length + 1);
+        glGetShaderSource(shaders[i], length + 1, &length, &source[0]);
+        if (length <= 0) {
+            // programs differing only in sources not passed to GL would get the same hash
+            printf("%s: shader %u has no source, the program can't be cached\n", __FUNCTION__, shaders[i]);
+            return UNCACHEABLE;
+        }
+        
+        uint64_t h = Hash64(&type, sizeof(type));
+        h = Hash64(&source[0], length, h);
+        shadersHash += h * 2 + 1;
+    }
+    
+    uint64_t hash = Hash64(&shadersHash, sizeof(shadersHash));
+    const LinkData* data = GetData();
+    for (unsigned i=0; i<data->attribBindings.size(); i++) {
+        hash = Hash64(&data->attribBindings[i].first, sizeof(GLuint), hash);
+        hash = Hash64(data->attribBindings[i].second.c_str(), data->attribBindings[i].second.size() + 1, hash);
+    }
+    return hash != UNCACHEABLE ? hash : 1;
+}
+
+/// Returns size of a uniform value of the type in bytes
+static unsigned UniformTypeSize(GLenum type)
+{
+    switch (type) {
+        case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2:
+            return 2 * 4;
+        case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3:
+            return 3 * 4;
+        case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2:
+            return 4 * 4;
+        case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3x2:
+            return 6 * 4;
+        case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT4x2:
+            return 8 * 4;
+        case GL_FLOAT_MAT3:
+            return 9 * 4;
+        case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x3:
+            return 12 * 4;
+        case GL_FLOAT_MAT4:
+            return 16 * 4;
+        case GL_DOUBLE:
+            return 8;
+        case GL_DOUBLE_VEC2:
+            return 2 * 8;
+        case GL_DOUBLE_VEC3:
+            return 3 * 8;
+        case GL_DOUBLE_VEC4: case GL_DOUBLE_MAT2:
+            return 4 * 8;
+        case GL_DOUBLE_MAT3:
+            return 9 * 8;
+        case GL_DOUBLE_MAT4:
+            return 16 * 8;
+        case GL_DOUBLE_MAT2x3: case GL_DOUBLE_MAT3x2:
+            return 6 * 8;
+        case GL_DOUBLE_MAT2x4: case GL_DOUBLE_MAT4x2:
+            return 8 * 8;
+        case GL_DOUBLE_MAT3x4: case GL_DOUBLE_MAT4x3:
+            return 12 * 8;
+        default:
+            return 4; // float, int, uint, bool, samplers and images
+    }
+}
+
+/// Reads current value of the uniform into the shadow storage
+static void ReadUniformValue(GLuint program, GLint location, GLenum type, void* out)
+{
+    switch (type) {
+        case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+        case GL_FLOAT_MAT2: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4:
+        case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT3x2:
+        case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3:
+            glGetUniformfv(program, location, (GLfloat*)out);
+            break;
+        case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+            glGetUniformuiv(program, location, (GLuint*)out);
+            break;
+        case GL_DOUBLE: case GL_DOUBLE_VEC2: case GL_DOUBLE_VEC3: case GL_DOUBLE_VEC4:
+        case GL_DOUBLE_MAT2: case GL_DOUBLE_MAT3: case GL_DOUBLE_MAT4:
+        case GL_DOUBLE_MAT2x3: case GL_DOUBLE_MAT2x4: case GL_DOUBLE_MAT3x2:
+        case GL_DOUBLE_MAT3x4: case GL_DOUBLE_MAT4x2: case GL_DOUBLE_MAT4x3:
+            glGetUniformdv(program, location, (GLdouble*)out);
+            break;
+        default:
+            glGetUniformiv(program, location, (GLint*)out);
+            break;
+    }
+}
+
+Program::LinkData* Program::GetData()
+{
+    LinkData* data = (LinkData*)GetSharedData();
+    if (!data) {
+        data = new LinkData;
+        SetSharedData(data);
+    }
+    return data;
+}
+
+Program::LinkData* Program::GetLinkData()
+{
+    LinkData* data = GetData();
+    if (data->linkPending) {
+        // used before FinishLink, finish it here instead of building the data twice
+        return FinishLink() ? data : NULL;
+    }
+    if (!data->linked) {
+        // program linked without Link() of this object
+        if (!GetInt(GL_LINK_STATUS)) {
+            return NULL;
+        }
+        BuildLinkData();
+    }
+    return data;
+}
+
+static unsigned AppendName(std::vector<char>& pool, const char* name)
+{
+    unsigned offset = pool.size();
+    pool.insert(pool.end(), name, name + strlen(name) + 1);
+    return offset;
+}
+
+void Program::AddShadowSlot(LinkData* data, Uniform location, unsigned offset, unsigned end)
+{
+    if (location < 0) {
+        return;
+    }
+    if ((unsigned)location >= data->shadowSlots.size()) {
+        ShadowSlot none = { 0, 0 };
+        data->shadowSlots.resize(location + 1, none);
+    }
+    data->shadowSlots[location].offset = offset;
+    data->shadowSlots[location].end = end;
+}
+
+/// Returns true for sampler uniform types, their value is a texture unit
+static bool IsSamplerType(GLenum type)
+{
+    switch (type) {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_SAMPLER_BUFFER: case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW:
+        case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+        case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY:
+        case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_INT_SAMPLER_BUFFER: case GL_INT_SAMPLER_2D_RECT:
+        case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+        case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void Program::BuildReflection(ProgramReflection& reflection)
+{
+    reflection.Clear();
+    
+    GLint maxLen = GetInt(GL_ACTIVE_ATTRIBUTE_MAX_LENGTH);
+    maxLen = std::max(maxLen, GetInt(GL_ACTIVE_UNIFORM_MAX_LENGTH));
+    maxLen = std::max(maxLen, GetInt(GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH));
+    std::vector<char> name(maxLen + 1);
+    GLsizei len;
+    ProgramReflection::NameOffsets offsets;
+    
+    GLint num = GetInt(GL_ACTIVE_ATTRIBUTES);
+    reflection.attributes.resize(num);
+    for (GLint i=0; i<num; i++) {
+        ProgramReflection::Attribute& a = reflection.attributes[i];
+        glGetActiveAttrib(*this, i, name.size(), &len, &a.size, &a.type, &name[0]);
+        a.location = glGetAttribLocation(*this, &name[0]);
+        a.name = reflection.InternName(&name[0], offsets);
+    }
+    
+    num = GetInt(GL_ACTIVE_UNIFORMS);
+    reflection.uniforms.resize(num);
+    if (num > 0) {
+        // block layout of all uniforms is queried at once
+        std::vector<GLuint> indices(num);
+        std::vector<GLint> block(num), offset(num), arrayStride(num), matrixStride(num);
+        for (GLint i=0; i<num; i++) {
+            indices[i] = i;
+        }
+        glGetActiveUniformsiv(*this, num, &indices[0], GL_UNIFORM_BLOCK_INDEX, &block[0]);
+        glGetActiveUniformsiv(*this, num, &indices[0], GL_UNIFORM_OFFSET, &offset[0]);
+        glGetActiveUniformsiv(*this, num, &indices[0], GL_UNIFORM_ARRAY_STRIDE, &arrayStride[0]);
+        glGetActiveUniformsiv(*this, num, &indices[0], GL_UNIFORM_MATRIX_STRIDE, &matrixStride[0]);
+        
+        for (GLint i=0; i<num; i++) {
+            ProgramReflection::Uniform& u = reflection.uniforms[i];
+            glGetActiveUniform(*this, i, name.size(), &len, &u.size, &u.type, &name[0]);
+            u.name = reflection.InternName(&name[0], offsets);
+            u.location = block[i] < 0 ? glGetUniformLocation(*this, &name[0]) : -1;
+            u.block = block[i];
+            u.offset = offset[i];
+            u.arrayStride = arrayStride[i];
+            u.matrixStride = matrixStride[i];
+            u.binding = -1;
+            if (u.location >= 0 && IsSamplerType(u.type)) {
+                glGetUniformiv(*this, u.location, &u.binding);
+            }
+        }
+    }
+    
+    num = GetInt(GL_ACTIVE_UNIFORM_BLOCKS);
+    reflection.blocks.resize(num);
+    for (GLint i=0; i<num; i++) {
+        ProgramReflection::UniformBlock& b = reflection.blocks[i];
+        glGetActiveUniformBlockName(*this, i, name.size(), &len, &name[0]);
+        b.name = reflection.InternName(&name[0], offsets);
+        glGetActiveUniformBlockiv(*this, i, GL_UNIFORM_BLOCK_DATA_SIZE, &b.dataSize);
+        glGetActiveUniformBlockiv(*this, i, GL_UNIFORM_BLOCK_BINDING, &b.binding);
+    }
+}
+
+void Program::BuildLinkData()
+{
+    LinkData* data = GetData();
+    data->uniformTable.clear();
+    data->uniformNames.clear();
+    data->shadow.clear();
+    data->shadowSlots.clear();
+    data->issuedUniformUpdates = 0;
+    data->skippedUniformUpdates = 0;
+    data->linked = true;
+    
+    const ProgramReflection& reflection = data->reflection;
+    BuildReflection(data->reflection);
+    
+    std::vector<char> name;
+    std::vector<UniformSlot> found;
+    
+    for (unsigned i=0; i<reflection.uniforms.size(); i++) {
+        const ProgramReflection::Uniform& uniform = reflection.uniforms[i];
+        if (uniform.location < 0) {
+            continue; // uniform block member
+        }
+        const char* uniformName = reflection.GetName(uniform.name);
+        size_t len = strlen(uniformName);
+        name.assign(uniformName, uniformName + len + 1);
+        name.resize(len + 16); // space for array index
+        
+        UniformSlot u;
+        u.location = uniform.location;
+        u.hash = UniformName::Hash(&name[0]);
+        u.name = AppendName(data->uniformNames, &name[0]);
+        u.sharedHash = false;
+        found.push_back(u);
+        
+        // shadow storage keeps array elements contiguous, so array setters can compare all at once
+        unsigned elementSize = UniformTypeSize(uniform.type);
+        unsigned offset = data->shadow.size();
+        unsigned end = offset + elementSize * uniform.size;
+        data->shadow.resize(end);
+        AddShadowSlot(data, u.location, offset, end);
+        ReadUniformValue(*this, u.location, uniform.type, &data->shadow[offset]);
+        
+        // arrays are reported as "name[0]", make "name" and "name[i]" resolvable as well
+        if (len > 3 && !strcmp(&name[len-3], "[0]")) {
+            name[len-3] = '\0';
+            u.hash = UniformName::Hash(&name[0]);
+            u.name = AppendName(data->uniformNames, &name[0]);
+            found.push_back(u);
+            
+            for (GLint e=1; e<uniform.size; e++) {
+                sprintf(&name[len-3], "[%d]", e);
+                u.location = glGetUniformLocation(*this, &name[0]);
+                u.hash = UniformName::Hash(&name[0]);
+                u.name = AppendName(data->uniformNames, &name[0]);
+                found.push_back(u);
+                
+                AddShadowSlot(data, u.location, offset + e * elementSize, end);
+                ReadUniformValue(*this, u.location, uniform.type, &data->shadow[offset + e * elementSize]);
+            }
+        }
+    }
+    
+    unsigned tableSize = 1;
+    while (tableSize < found.size() * 2) {
+        tableSize *= 2;
+    }
+    
+    UniformSlot empty = { 0, 0, -1, false };
+    UniformTable& table = data->uniformTable;
+    table.assign(tableSize, empty);
+    const char* names = data->uniformNames.empty() ? NULL : &data->uniformNames[0];
+    
+    for (unsigned i=0; i<found.size(); i++) {
+        unsigned slot = found[i].hash & (tableSize - 1);
+        bool duplicate = false;
+        while (table[slot].location >= 0) {
+            if (table[slot].hash == found[i].hash) {
+                if (!strcmp(names + table[slot].name, names + found[i].name)) {
+                    duplicate = true;
+                    break;
+                }
+                // different names of the same hash stay in the probe chain, lookups tell them apart by name
+                table[slot].sharedHash = true;
+                found[i].sharedHash = true;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (!duplicate) {
+            table[slot] = found[i];
+        }
+    }
 }
 
 Program& Program::Validate()
@@ -161,15 +879,24 @@ std::string Program::GetInfoLog()const
 Program& Program::Use()
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundProgram == *this)
+    if (!GLStateCache::Current().SetProgram(*this))
         return *this;
-    s_boundProgram = *this;
 #endif
     
     glUseProgram(*this);
     return *this;
 }
 
+void Program::BindNone()
+{
+#ifdef GLFK_PREVENT_MULTIPLE_BIND
+    if (!GLStateCache::Current().SetProgram(0))
+        return;
+#endif
+    
+    glUseProgram(0);
+}
+
 void Program::SetDrawBuffers(unsigned numArgs, DrawBufferType::E type, ...)
 {
     typedef std::vector<GLenum> DrawBuffersArray;
@@ -199,6 +926,12 @@ Program& Program::DispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLui
 
 Program& Program::BindAttribLocation(GLuint attribIndex, const GLchar *name)
 {
+    LinkData* data = GetData();
+    data->attribBindings.push_back(std::make_pair(attribIndex, std::string(name)));
+    if (!IsCreated()) {
+        data->deferredBindings = true;
+        return *this;
+    }
     glBindAttribLocation(*this, attribIndex, name);
     return *this;
 }
@@ -210,117 +943,333 @@ GLint Program::GetInt(GLenum pname)const
     return ret;
 }
 
+const ProgramReflection* Program::GetReflection()
+{
+    LinkData* data = GetLinkData();
+    return data ? &data->reflection : NULL;
+}
+
 Attribute Program::GetAttribute(const std::string& name)
 {
-    Attribute out = glGetAttribLocation( *this, name.c_str() );
-    return out;
+    const ProgramReflection* reflection = GetReflection();
+    if (!reflection) {
+        return glGetAttribLocation(*this, name.c_str());
+    }
+    int index = reflection->FindAttribute(name.c_str());
+    return index < 0 ? -1 : reflection->attributes[index].location;
 }
 
 AttributeInfo Program::GetAttributeInfo(const Attribute &a)
 {
-    char buff[256];
-    GLsizei len = sizeof(buff);
     AttributeInfo i;
+    const ProgramReflection* reflection = GetReflection();
+    if (!reflection || a < 0 || (unsigned)a >= reflection->attributes.size()) {
+        i.type = (ShaderAttribType::E)0;
+        i.size = 0;
+        return i;
+    }
     
-    glGetActiveAttrib(*this, a, len, &len, &i.size, (GLenum*)&i.type, buff);
-    i.name = buff;
-    
+    const ProgramReflection::Attribute& attrib = reflection->attributes[a];
+    i.name = reflection->GetName(attrib.name);
+    i.type = (ShaderAttribType::E)attrib.type;
+    i.size = attrib.size;
     return i;
 }
 
-Uniform Program::GetUniform(const std::string& name)
+Uniform Program::GetUniform(const UniformName& name)
 {
-    Uniform out = glGetUniformLocation(*this, name.c_str());
-    return out;
+    LinkData* data = GetLinkData();
+    if (!data) {
+        return -1;
+    }
+    
+    const UniformTable& table = data->uniformTable;
+    unsigned mask = table.size() - 1;
+    unsigned slot = name.GetHash() & mask;
+    while (table[slot].location >= 0) {
+        const UniformSlot& entry = table[slot];
+        if (entry.hash == name.GetHash()) {
+#ifdef DEBUG
+            bool compare = name.GetName() != NULL;
+#else
+            bool compare = entry.sharedHash && name.GetName();
+#endif
+            // without a name the first entry of the hash is the best guess
+            if (!compare || !strcmp(&data->uniformNames[entry.name], name.GetName())) {
+                return entry.location;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+bool Program::UpdateShadow(const Uniform& uniform, const void* value, unsigned size)
+{
+    LinkData* data = GetLinkData();
+    if (!data) {
+        return true;
+    }
+    
+    if (uniform < 0) {
+        // GL ignores location -1, no need to bind the program for it
+        data->skippedUniformUpdates++;
+        return false;
+    }
+    
+    if ((unsigned)uniform < data->shadowSlots.size()) {
+        const ShadowSlot& slot = data->shadowSlots[uniform];
+        if (slot.offset + size <= slot.end) {
+            unsigned char* shadow = &data->shadow[slot.offset];
+            if (!memcmp(shadow, value, size)) {
+                data->skippedUniformUpdates++;
+                return false;
+            }
+            memcpy(shadow, value, size);
+        }
+    }
+    
+    data->issuedUniformUpdates++;
+    return true;
+}
+
+unsigned Program::GetIssuedUniformUpdates()
+{
+    LinkData* data = GetLinkData();
+    return data ? data->issuedUniformUpdates : 0;
+}
+
+unsigned Program::GetSkippedUniformUpdates()
+{
+    LinkData* data = GetLinkData();
+    return data ? data->skippedUniformUpdates : 0;
+}
+
+Program& Program::ResetUniformUpdateCounters()
+{
+    LinkData* data = GetLinkData();
+    if (data) {
+        data->issuedUniformUpdates = 0;
+        data->skippedUniformUpdates = 0;
+    }
+    return *this;
 }
 
 std::string Program::GetUniformName(const Uniform &u)
 {
-    char buff[256];
-    GLsizei len = sizeof(buff);
-    glGetActiveUniformName(*this, u, len, &len, buff);
-    return buff;
+    const ProgramReflection* reflection = GetReflection();
+    if (!reflection || u < 0 || (unsigned)u >= reflection->uniforms.size()) {
+        return std::string();
+    }
+    return reflection->GetName(reflection->uniforms[u].name);
 }
 
 UniformInfo Program::GetUniformInfo(const Uniform& u)
 {
-    char buff[256];
-    GLsizei len = sizeof(buff);
     UniformInfo i;
+    const ProgramReflection* reflection = GetReflection();
+    if (!reflection || u < 0 || (unsigned)u >= reflection->uniforms.size()) {
+        i.type = (ShaderUniformType::E)0;
+        i.size = 0;
+        return i;
+    }
     
-    glGetActiveUniform(*this, u, len, &len, &i.size, (GLenum*)&i.type, buff);
-    i.name = buff;
-    
+    const ProgramReflection::Uniform& uniform = reflection->uniforms[u];
+    i.name = reflection->GetName(uniform.name);
+    i.type = (ShaderUniformType::E)uniform.type;
+    i.size = uniform.size;
     return i;
 }
 
+unsigned Program::GetNumActiveAttributes()
+{
+    const ProgramReflection* reflection = GetReflection();
+    return reflection ? reflection->attributes.size() : 0;
+}
+
+unsigned Program::GetNumActiveUniforms()
+{
+    const ProgramReflection* reflection = GetReflection();
+    return reflection ? reflection->uniforms.size() : 0;
+}
+
+GLuint Program::GetUniformIndex(const char* name)
+{
+    GLuint index;
+    glGetUniformIndices(*this, 1, &name, &index);
+    return index;
+}
+
+GLint Program::GetActiveUniformInt(GLuint index, GLenum pname)
+{
+    GLint out;
+    glGetActiveUniformsiv(*this, 1, &index, pname, &out);
+    return out;
+}
+
+GLuint Program::GetUniformBlockIndex(const char* name)
+{
+    return glGetUniformBlockIndex(*this, name);
+}
+
+GLint Program::GetUniformBlockInt(GLuint blockIndex, GLenum pname)
+{
+    GLint out;
+    glGetActiveUniformBlockiv(*this, blockIndex, pname, &out);
+    return out;
+}
+
+Program& Program::SetUniformBlockBinding(GLuint blockIndex, GLuint binding)
+{
+    glUniformBlockBinding(*this, blockIndex, binding);
+    return *this;
+}
+
 Program& Program::SetUniformInt(const Uniform& uniform, int value)
 {
-    GLFK_AUTO_BIND();
-    glUniform1i(uniform, value);
+    int v[] = { value };
+    if (!UpdateShadow(uniform, v, sizeof(v))) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform1i(*this, uniform, value);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform1i(uniform, value);
+    }
     return *this;
 }
 
 Program& Program::SetUniformInt(const Uniform& uniform, int x, int y)
 {
-    GLFK_AUTO_BIND();
-    glUniform2i(uniform, x, y);
+    int v[] = { x, y };
+    if (!UpdateShadow(uniform, v, sizeof(v))) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform2i(*this, uniform, x, y);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform2i(uniform, x, y);
+    }
     return *this;
 }
 
 Program& Program::SetUniformInt(const Uniform& uniform, int x, int y, int z)
 {
-    GLFK_AUTO_BIND();
-    glUniform3i(uniform, x, y, z);
+    int v[] = { x, y, z };
+    if (!UpdateShadow(uniform, v, sizeof(v))) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform3i(*this, uniform, x, y, z);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform3i(uniform, x, y, z);
+    }
     return *this;
 }
 
 Program& Program::SetUniformInt(const Uniform& uniform, int x, int y, int z, int w)
 {
-    GLFK_AUTO_BIND();
-    glUniform4i(uniform, x, y, z, w);
+    int v[] = { x, y, z, w };
+    if (!UpdateShadow(uniform, v, sizeof(v))) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform4i(*this, uniform, x, y, z, w);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform4i(uniform, x, y, z, w);
+    }
     return *this;
 }
 
 Program& Program::SetUniformInt(const Uniform& uniform, const int* values, unsigned count)
 {
-    GLFK_AUTO_BIND();
-    glUniform1iv(uniform, count, values);
+    if (!UpdateShadow(uniform, values, sizeof(int) * count)) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform1iv(*this, uniform, count, values);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform1iv(uniform, count, values);
+    }
     return *this;
 }
 
 Program& Program::SetUniformFloat(const Uniform& uniform, float value)
 {
-    GLFK_AUTO_BIND();
-    glUniform1f(uniform, value);
+    float v[] = { value };
+    if (!UpdateShadow(uniform, v, sizeof(v))) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform1f(*this, uniform, value);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform1f(uniform, value);
+    }
     return *this;
 }
 
 Program& Program::SetUniformFloat(const Uniform& uniform, float x, float y)
 {
-    GLFK_AUTO_BIND();
-    glUniform2f(uniform, x, y);
+    float v[] = { x, y };
+    if (!UpdateShadow(uniform, v, sizeof(v))) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform2f(*this, uniform, x, y);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform2f(uniform, x, y);
+    }
     return *this;
 }
 
 Program& Program::SetUniformFloat(const Uniform& uniform, float x, float y, float z)
 {
-    GLFK_AUTO_BIND();
-    glUniform3f(uniform, x, y, z);
+    float v[] = { x, y, z };
+    if (!UpdateShadow(uniform, v, sizeof(v))) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform3f(*this, uniform, x, y, z);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform3f(uniform, x, y, z);
+    }
     return *this;
 }
 
 Program& Program::SetUniformFloat(const Uniform& uniform, float x, float y, float z, float w)
 {
-    GLFK_AUTO_BIND();
-    glUniform4f(uniform, x, y, z, w);
+    float v[] = { x, y, z, w };
+    if (!UpdateShadow(uniform, v, sizeof(v))) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform4f(*this, uniform, x, y, z, w);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform4f(uniform, x, y, z, w);
+    }
     return *this;
 }
 
 Program& Program::SetUniformFloat(const Uniform& uniform, const float* values, unsigned count)
 {
-    GLFK_AUTO_BIND();
-    glUniform1fv(uniform, count, values);
+    if (!UpdateShadow(uniform, values, sizeof(float) * count)) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform1fv(*this, uniform, count, values);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform1fv(uniform, count, values);
+    }
     return *this;
 }
 
@@ -342,36 +1291,197 @@ Program& Program::SetUniform(const Uniform& uniform, const glm::vec4& value)
 
 Program& Program::SetUniform(const Uniform& uniform, const glm::vec2* values, unsigned count)
 {
-    GLFK_AUTO_BIND();
-    glUniform2fv(uniform, count, (float*)values);
+    if (!UpdateShadow(uniform, values, sizeof(glm::vec2) * count)) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform2fv(*this, uniform, count, (float*)values);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform2fv(uniform, count, (float*)values);
+    }
     return *this;
 }
 
 Program& Program::SetUniform(const Uniform& uniform, const glm::vec3* values, unsigned count)
 {
-    GLFK_AUTO_BIND();
-    glUniform3fv(uniform, count, (float*)values);
+    if (!UpdateShadow(uniform, values, sizeof(glm::vec3) * count)) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform3fv(*this, uniform, count, (float*)values);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform3fv(uniform, count, (float*)values);
+    }
     return *this;
 }
 
 Program& Program::SetUniform(const Uniform& uniform, const glm::vec4* values, unsigned count)
 {
-    GLFK_AUTO_BIND();
-    glUniform4fv(uniform, count, (float*)values);
+    if (!UpdateShadow(uniform, values, sizeof(glm::vec4) * count)) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniform4fv(*this, uniform, count, (float*)values);
+    } else {
+        GLFK_AUTO_BIND();
+        glUniform4fv(uniform, count, (float*)values);
+    }
     return *this;
 }
 
 Program& Program::SetUniform(const Uniform& uniform, const glm::mat3x3& value)
 {
-    GLFK_AUTO_BIND();
-    glUniformMatrix3fv(uniform, 1, GL_FALSE, glm::value_ptr(value));
+    if (!UpdateShadow(uniform, glm::value_ptr(value), sizeof(glm::mat3x3))) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniformMatrix3fv(*this, uniform, 1, GL_FALSE, glm::value_ptr(value));
+    } else {
+        GLFK_AUTO_BIND();
+        glUniformMatrix3fv(uniform, 1, GL_FALSE, glm::value_ptr(value));
+    }
     return *this;
 }
 
 Program& Program::SetUniform( const Uniform& uniform, const glm::mat4x4& value)
 {
-    GLFK_AUTO_BIND();
-    glUniformMatrix4fv(uniform, 1, GL_FALSE, glm::value_ptr(value));
+    if (!UpdateShadow(uniform, glm::value_ptr(value), sizeof(glm::mat4x4))) {
+        return *this;
+    }
+    if (Renderer::HasSeparateShaderObjects()) {
+        glProgramUniformMatrix4fv(*this, uniform, 1, GL_FALSE, glm::value_ptr(value));
+    } else {
+        GLFK_AUTO_BIND();
+        glUniformMatrix4fv(uniform, 1, GL_FALSE, glm::value_ptr(value));
+    }
+    return *this;
+}
+#endif
+
+//----------------------------------------------------------------------------
+
+/// Creates names of pipelines deferred by the constructor
+static void CreateProgramPipelines(GLenum, GLsizei n, GLuint* names)
+{
+    glGenProgramPipelines(n, names);
+}
+
+ProgramPipeline::ProgramPipeline()
+{
+    DeferGLObject(CreateProgramPipelines, 0, glDeleteProgramPipelines);
+}
+
+ProgramPipeline::PipelineData* ProgramPipeline::GetData()
+{
+    PipelineData* data = (PipelineData*)GetSharedData();
+    if (!data) {
+        data = new PipelineData;
+        SetSharedData(data);
+    }
+    return data;
+}
+
+ProgramPipeline& ProgramPipeline::UseProgramStages(GLbitfield stages, const Program& program)
+{
+    assert(Renderer::HasSeparateShaderObjects());
+    glUseProgramStages(*this, stages, program);
+    
+    ClearStages(stages);
+    PipelineData* data = GetData();
+    data->programs.push_back(program);
+    data->stages.push_back(stages);
+    return *this;
+}
+
+ProgramPipeline& ProgramPipeline::ClearStages(GLbitfield stages)
+{
+    PipelineData* data = GetData();
+    for (unsigned i=0; i<data->programs.size(); ) {
+        data->stages[i] &= ~stages;
+        if (data->stages[i] == 0) {
+            data->programs.erase(data->programs.begin() + i);
+            data->stages.erase(data->stages.begin() + i);
+        } else {
+            i++;
+        }
+    }
     return *this;
 }
+
+bool ProgramPipeline::HasStage(ProgramStage::E stage)
+{
+    return GetStage(stage) != NULL;
+}
+
+Program* ProgramPipeline::GetStage(ProgramStage::E stage)
+{
+    PipelineData* data = GetData();
+    for (unsigned i=0; i<data->programs.size(); i++) {
+        if (data->stages[i] & stage) {
+            return &data->programs[i];
+        }
+    }
+    return NULL;
+}
+
+Program* ProgramPipeline::GetUsedStage(ProgramStage::E stage)
+{
+    Program* program = GetStage(stage);
+    if (!program) {
+        printf("%s: no program for stage 0x%X\n", __FUNCTION__, (unsigned)stage);
+    }
+    return program;
+}
+
+ProgramPipeline& ProgramPipeline::Bind()
+{
+    // a program made current by glUseProgram takes precedence over the bound pipeline
+    Program::BindNone();
+    
+#ifdef GLFK_PREVENT_MULTIPLE_BIND
+    if (!GLStateCache::Current().SetProgramPipeline(*this))
+        return *this;
 #endif
+    
+    glBindProgramPipeline(*this);
+    return *this;
+}
+
+void ProgramPipeline::BindNone()
+{
+#ifdef GLFK_PREVENT_MULTIPLE_BIND
+    if (!GLStateCache::Current().SetProgramPipeline(0))
+        return;
+#endif
+    
+    glBindProgramPipeline(0);
+}
+
+bool ProgramPipeline::Validate()
+{
+    glValidateProgramPipeline(*this);
+    GLint status = 0;
+    glGetProgramPipelineiv(*this, GL_VALIDATE_STATUS, &status);
+    return status != GL_FALSE;
+}
+
+std::string ProgramPipeline::GetInfoLog()const
+{
+    std::string outLog;
+    GLint logSize = 0;
+
+    glGetProgramPipelineiv(*this, GL_INFO_LOG_LENGTH, &logSize);
+    if (logSize <= 0) {
+        return outLog;
+    }
+
+    GLchar *errorLog = (GLchar *)malloc(logSize);
+    glGetProgramPipelineInfoLog(*this, logSize, &logSize, errorLog);
+    
+    outLog = errorLog;
+    free(errorLog);
+
+    return outLog;
+}
@@ -7,9 +7,22 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 #include "Renderer.h"
 #include "Utils.h"
 
+#include <map>
 #include <string>
 #include <vector>
 
+/// Piece of shader source referenced without copying, it must stay alive until SetSource returns
+struct ShaderSourceView {
+    /// Zero-terminated string
+    ShaderSourceView(const char* str) : data(str), length(-1) {};
+    ShaderSourceView(const char* data, GLint length) : data(data), length(length) {};
+    ShaderSourceView(const std::string& str) : data(str.data()), length(str.size()) {};
+    ShaderSourceView(const MappedFile& file) : data(file.GetData()), length(file.GetSize()) {};
+    
+    const char* data;
+    GLint length; ///< negative for zero-terminated data
+};
+
 /// Class encapsulating Shader Object
 class BaseShader : public GLObject
 {
@@ -17,22 +30,55 @@ class BaseShader : public GLObject
 
 public:
     BaseShader(GLenum shaderType);
-    BaseShader(GLenum shaderType, std::string source);
+    BaseShader(GLenum shaderType, const std::string& source);
 
     /// Compiles the shader and returns the compile status
     bool Compile();
+    /// Starts compiling the shader without waiting for the result
+    BaseShader& CompileAsync();
+    /// Returns true if the compile finished and FinishCompile() won't block.
+    /// Always true without parallel shader compile (Renderer::HasParallelShaderCompile).
+    bool IsReady()const;
+    /// Waits for the compile started by CompileAsync() and returns the compile status
+    bool FinishCompile();
     
     /// Returns the shader info log
     std::string GetInfoLog()const;
     
     /// Sets the shader source code
-    BaseShader& SetSource(std::string str);
+    BaseShader& SetSource(const std::string& str);
+    /// Sets the shader source code made of several pieces (version header, defines, mapped files...),
+    /// passed to GL without concatenating them
+    BaseShader& SetSource(const ShaderSourceView* views, unsigned count);
+    /// Sets the shader source code from a memory mapped file
+    BaseShader& SetSourceFile(const char* path);
     
     /// Returns true if the shader has been compiled successfuly and is ready to be linked in a program.
-    bool IsValid()const{ return _valid; };
+    bool IsValid()const{
+        const ShaderData* data = (const ShaderData*)GetSharedData();
+        return data && data->valid;
+    };
+    /// Returns true if compiling of the current source was started, by this object or by a copy
+    bool IsCompiled()const{
+        const ShaderData* data = (const ShaderData*)GetSharedData();
+        return data && data->compiled;
+    };
 
 private:
-    bool _valid;
+    /// Compile status and source set by a thread without a context, shared by all copies
+    struct ShaderData : public GLObjectData {
+        ShaderData() : sourcePending(false), compiled(false), valid(false) {};
+        
+        /// Source set by a thread without a context (e.g. a loading thread), passed to GL once the shader is created
+        std::string source;
+        bool sourcePending;
+        bool compiled;
+        bool valid;
+    };
+    
+    ShaderData* GetShaderData();
+    /// Pass the source set by a thread without a context to GL, creating the shader
+    void UploadSource();
 };
 
 /// Program object of type GL_VERTEX_SHADER
@@ -40,10 +86,12 @@ class VertexShader : public BaseShader
 {
 public:
     VertexShader() : BaseShader(GL_VERTEX_SHADER) {};
-    VertexShader(std::string source) : BaseShader(GL_VERTEX_SHADER, source) {};
+    VertexShader(const std::string& source) : BaseShader(GL_VERTEX_SHADER, source) {};
     
     static VertexShader FromFile(const char* path){
-        return VertexShader(ReadFile(path));
+        VertexShader sh;
+        sh.SetSourceFile(path);
+        return sh;
     }
     
     // helpers 
@@ -55,10 +103,12 @@ class FragmentShader : public BaseShader
 {
 public:
     FragmentShader() : BaseShader(GL_FRAGMENT_SHADER) {};
-    FragmentShader(std::string source) : BaseShader(GL_FRAGMENT_SHADER, source) {};
+    FragmentShader(const std::string& source) : BaseShader(GL_FRAGMENT_SHADER, source) {};
     
     static FragmentShader FromFile(const char* path){
-        return FragmentShader(ReadFile(path));
+        FragmentShader sh;
+        sh.SetSourceFile(path);
+        return sh;
     }
 };
 /// Alias of FragmentShader
@@ -69,10 +119,12 @@ class ComputeShader : public BaseShader
 {
 public:
     ComputeShader() : BaseShader(GL_COMPUTE_SHADER) {};
-    ComputeShader(std::string source) : BaseShader(GL_COMPUTE_SHADER, source) {};
+    ComputeShader(const std::string& source) : BaseShader(GL_COMPUTE_SHADER, source) {};
     
     static ComputeShader FromFile(const char* path){
-        return ComputeShader(ReadFile(path));
+        ComputeShader sh;
+        sh.SetSourceFile(path);
+        return sh;
     }
 };
 
@@ -81,10 +133,12 @@ class GeometryShader : public BaseShader
 {
 public:
     GeometryShader() : BaseShader(GL_GEOMETRY_SHADER) {};
-    GeometryShader(std::string source) : BaseShader(GL_GEOMETRY_SHADER, source) {};
+    GeometryShader(const std::string& source) : BaseShader(GL_GEOMETRY_SHADER, source) {};
     
     static GeometryShader FromFile(const char* path){
-        return GeometryShader(ReadFile(path));
+        GeometryShader sh;
+        sh.SetSourceFile(path);
+        return sh;
     }
 };
 
@@ -93,10 +147,12 @@ class TessEvaluationShader : public BaseShader
 {
 public:
     TessEvaluationShader() : BaseShader(GL_TESS_EVALUATION_SHADER) {};
-    TessEvaluationShader(std::string source) : BaseShader(GL_TESS_EVALUATION_SHADER, source) {};
+    TessEvaluationShader(const std::string& source) : BaseShader(GL_TESS_EVALUATION_SHADER, source) {};
     
     static TessEvaluationShader FromFile(const char* path){
-        return TessEvaluationShader(ReadFile(path));
+        TessEvaluationShader sh;
+        sh.SetSourceFile(path);
+        return sh;
     }
 };
 
@@ -105,16 +161,45 @@ class TessControlShader : public BaseShader
 {
 public:
     TessControlShader() : BaseShader(GL_TESS_CONTROL_SHADER) {};
-    TessControlShader(std::string source) : BaseShader(GL_TESS_CONTROL_SHADER, source) {};
+    TessControlShader(const std::string& source) : BaseShader(GL_TESS_CONTROL_SHADER, source) {};
     
     static TessControlShader FromFile(const char* path){
-        return TessControlShader(ReadFile(path));
+        TessControlShader sh;
+        sh.SetSourceFile(path);
+        return sh;
     }
 };
 
 typedef GLint Attribute;
 typedef GLint Uniform;
 
+/** Uniform name represented by its hash, used for looking up uniform locations without calling GL.
+
+The hash is computed at compile time when a literal is used to initialize a constant, e.g.
+static const UniformName u_color("u_vColor");
+*/
+class UniformName
+{
+public:
+    /// The name is referenced, not copied, it must outlive the UniformName (e.g. a string literal)
+    GLFK_CONSTEXPR UniformName(const char* name) : _name(name), _hash(Hash(name)) {};
+    /// Keeps only the hash, lookups can't tell apart names of the same hash
+    UniformName(const std::string& name) : _name(NULL), _hash(Hash(name.c_str())) {};
+    
+    GLFK_CONSTEXPR unsigned GetHash()const{ return _hash; };
+    /// Returns the name to confirm a lookup, NULL if only the hash is known
+    GLFK_CONSTEXPR const char* GetName()const{ return _name; };
+    
+    /// FNV-1a hash of the name
+    static GLFK_CONSTEXPR unsigned Hash(const char* s, unsigned h = 2166136261u) {
+        return *s ? Hash(s + 1, (h ^ (unsigned char)*s) * 16777619u) : h;
+    }
+
+private:
+    const char* _name;
+    unsigned _hash;
+};
+
 struct UniformInfo {
     std::string name;
     ShaderUniformType::E type;
@@ -126,6 +211,59 @@ struct AttributeInfo {
     GLint size;
 };
 
+/** Reflection of a linked program, built once at link time so it can be read without querying GL.
+
+Entries are stored in contiguous arrays in the order of active indices. Names are interned in a single
+pool and referenced by offset, see GetName(). The table can be serialized, e.g. next to a program binary.
+*/
+struct ProgramReflection {
+    struct Attribute {
+        unsigned name;
+        GLenum type;
+        GLint size;
+        GLint location;
+    };
+    struct Uniform {
+        unsigned name;
+        GLenum type;
+        GLint size;
+        GLint location; ///< -1 for uniform block members
+        GLint block; ///< index of the uniform block or -1
+        GLint offset; ///< byte offset in the block, -1 outside of blocks
+        GLint arrayStride;
+        GLint matrixStride;
+        GLint binding; ///< texture unit assigned to a sampler, -1 for other types
+    };
+    struct UniformBlock {
+        unsigned name;
+        GLint dataSize;
+        GLint binding;
+    };
+    
+    std::vector<Attribute> attributes;
+    std::vector<Uniform> uniforms;
+    std::vector<UniformBlock> blocks;
+    /// Zero-terminated names
+    std::vector<char> names;
+    
+    const char* GetName(unsigned name)const{ return &names[name]; };
+    /// Returns index of the entry with the name or -1
+    int FindAttribute(const char* name)const;
+    int FindUniform(const char* name)const;
+    int FindBlock(const char* name)const;
+    
+    /// Offsets of the names interned so far, kept only while the table is built
+    typedef std::map<std::string, unsigned> NameOffsets;
+    /// Adds the name into the pool unless it is in offsets already, returns its offset
+    unsigned InternName(const char* name, NameOffsets& offsets);
+    void Clear();
+    
+    /// Appends the table to the data
+    void Serialize(std::vector<unsigned char>& data)const;
+    /// Reads table written by Serialize, returns false if the data is not valid
+    bool Deserialize(const unsigned char* data, size_t size);
+};
+
 /// Program Object
 class Program : public GLObject
 {
@@ -133,11 +271,11 @@ public:
     /// Empty program object
     Program();
     
-    /// Program object with supplied shader. Shader will be compiled if not compiled already.
+    /// Program object with supplied shader. Shader will be compiled by Link() if not compiled already.
     Program(BaseShader& sh);
-    /// Program with supplied shaders. Shader will be compiled if not compiled already.
+    /// Program with supplied shaders. Shader will be compiled by Link() if not compiled already.
     Program(BaseShader& sh1, BaseShader& sh2);
-    /// Program with supplied shaders. Shader will be compiled if not compiled already.
+    /// Program with supplied shaders. Shader will be compiled by Link() if not compiled already.
     Program(BaseShader& sh1, BaseShader& sh2, BaseShader& sh3);
     
     /// Program object with supplied shader. Shader must be compiled manually before linking.
@@ -147,7 +285,8 @@ public:
     /// Program with supplied shaders. Shaders must be compiled manually before linking.
     Program(const BaseShader& sh1, const BaseShader& sh2, const BaseShader& sh3);
     
-    /// Attachs a shader object into the program. Shader will be compiled if not compiled already.
+    /// Attachs a shader object into the program. Shader will be compiled by Link() if not compiled already,
+    /// so a program restored by ProgramBinary() doesn't compile its shaders at all.
     Program& AttachShader(BaseShader& sh);
     
     /// Attachs a shader object into the program. Shader must be compiled manually before linking.
@@ -155,6 +294,34 @@ public:
     
     /// Links the attached shaders. Possible errors returned by GetInfoLog().
     bool Link();
+    /// Starts compiling pending shaders and linking without waiting for the result
+    Program& LinkAsync();
+    /// Returns true if the link started by LinkAsync() finished and FinishLink() won't block.
+    /// Always true without parallel shader compile (Renderer::HasParallelShaderCompile).
+    bool IsReady()const;
+    /// Waits for the link started by LinkAsync() and returns the link status
+    bool FinishLink();
+    
+    /// Restores the program from a binary returned by GetProgramBinary(), instead of linking it.
+    /// Returns false if the binary was rejected (e.g. the driver changed), the program must be linked then.
+    bool ProgramBinary(GLenum format, const void* binary, GLsizei length);
+    /// Returns binary of the linked program, SetBinaryRetrievable(true) should be set before Link()
+    bool GetProgramBinary(std::vector<unsigned char>& binary, GLenum& format)const;
+    /// Hint the driver the binary will be retrieved after Link()
+    Program& SetBinaryRetrievable(bool retrievable);
+    
+    /// Allow using stages of the program in a ProgramPipeline, must be set before Link().
+    /// Requires Renderer::HasSeparateShaderObjects().
+    Program& SetSeparable(bool separable);
+    /// Returns separable program of a single stage compiled and linked from the source (glCreateShaderProgramv).
+    /// Check IsValid(), errors are printed.
+    static Program CreateShaderProgram(GLenum shaderType, const std::string& source);
+    
+    /// Hash returned by GetSourceHash() for programs whose sources can't be hashed
+    static const uint64_t UNCACHEABLE = 0;
+    /// Returns hash of sources of the attached shaders and of the attribute bindings. Returns UNCACHEABLE if a shader
+    /// has no source in GL, e.g. its source was never set, as programs differing only in it would share the hash.
+    uint64_t GetSourceHash();
     
     /// Validates the program can run in the current GL state. Possible errors returned by GetInfoLog().
     Program& Validate();
@@ -163,7 +330,11 @@ public:
     std::string GetInfoLog()const;
     
     /// Returns true if the program has been linked successfuly and is ready to be used.
-    bool IsValid()const{return _valid;};
+    /// Shared by all copies of the program.
+    bool IsValid()const{
+        const LinkData* data = (const LinkData*)GetSharedData();
+        return data && data->linked;
+    };
 
     /// Use the program
     Program& Use();
@@ -171,6 +342,10 @@ public:
     /// Alias of Use
     Program& Bind(){ return Use(); };
     
+    /// Use no program
+    static void BindNone();
+    Program& Unbind(){ BindNone(); return *this; };
+    
     /// Launches one or more compute work groups 
     Program& DispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
     
@@ -180,68 +355,85 @@ public:
     /// Returns integer param of the program object
     GLint GetInt(GLenum pname)const;
     
+    /// Returns reflection of the linked program or NULL if not linked
+    const ProgramReflection* GetReflection();
+    
     /// Returns attribute location for the specified name. Also see BindAttribLocation().
     Attribute GetAttribute(const std::string& name);
     
-    /// Returns attribute info
+    /// Returns info of the active attribute with the index
     AttributeInfo GetAttributeInfo(const Attribute& a);
     
-    /// Returns uniform for the specified name
-    Uniform GetUniform(const std::string& name);
+    /// Returns uniform for the specified name, or -1 if the program has no such active uniform.
+    /// Locations are read from a table built by Link(), without calling GL.
+    /// Setters keep a shadow copy of uniform values and call GL only when a value changes.
+    Uniform GetUniform(const UniformName& name);
     
-    /// Returns name of the uniform
+    /// Returns name of the active uniform with the index
     std::string GetUniformName(const Uniform& u);
     
-    /// Returns uniform info
+    /// Returns info of the active uniform with the index
     UniformInfo GetUniformInfo(const Uniform& u);
     
+    /// Returns index of the active uniform (not its location), also for uniform block members. GL_INVALID_INDEX if not found.
+    GLuint GetUniformIndex(const char* name);
+    /// Returns integer param of the active uniform with the index (GL_UNIFORM_OFFSET, GL_UNIFORM_ARRAY_STRIDE...)
+    GLint GetActiveUniformInt(GLuint index, GLenum pname);
+    
+    /// Returns index of the uniform block or GL_INVALID_INDEX if not found
+    GLuint GetUniformBlockIndex(const char* name);
+    /// Returns integer param of the uniform block (GL_UNIFORM_BLOCK_DATA_SIZE...)
+    GLint GetUniformBlockInt(GLuint blockIndex, GLenum pname);
+    /// Assigns the uniform block to the indexed GL_UNIFORM_BUFFER binding point
+    Program& SetUniformBlockBinding(GLuint blockIndex, GLuint binding);
+    
     template <typename T>
-    Program& SetUniform(const std::string& name, const T& value)
+    Program& SetUniform(const UniformName& name, const T& value)
     {
         return SetUniform(GetUniform(name), value);
     }
     
     template <typename T>
-    Program& SetUniformTextureUnit(const std::string& name, const T& value)
+    Program& SetUniformTextureUnit(const UniformName& name, const T& value)
     {
         return SetUniformTextureUnit(GetUniform(name), value);
     }
     
     template <typename T, typename U>
-    Program& SetUniformInt(const std::string& name, const T& x, const U& y)
+    Program& SetUniformInt(const UniformName& name, const T& x, const U& y)
     {
         return SetUniformInt(GetUniform(name), x, y);
     }
     template <typename T, typename U>
-    Program& SetUniformFloat(const std::string& name, const T& x, const U& y)
+    Program& SetUniformFloat(const UniformName& name, const T& x, const U& y)
     {
         return SetUniformFloat(GetUniform(name), (float)x, (float)y);
     }
     
     template <typename T, typename U, typename V>
-    Program& SetUniformInt(const std::string& name, const T& x, const U& y, const V& z)
+    Program& SetUniformInt(const UniformName& name, const T& x, const U& y, const V& z)
     {
         return SetUniformInt(GetUniform(name), x, y, z);
     }
     template <typename T, typename U, typename V>
-    Program& SetUniformFloat(const std::string& name, const T& x, const U& y, const V& z)
+    Program& SetUniformFloat(const UniformName& name, const T& x, const U& y, const V& z)
     {
         return SetUniformFloat(GetUniform(name), (float)x, (float)y, (float)z);
     }
     
     template <typename T, typename U, typename V, typename W>
-    Program& SetUniformInt(const std::string& name, const T& x, const U& y, const V& z, const W& w)
+    Program& SetUniformInt(const UniformName& name, const T& x, const U& y, const V& z, const W& w)
     {
         return SetUniformInt(GetUniform(name), x, y, z, w);
     }
     template <typename T, typename U, typename V, typename W>
-    Program& SetUniformFloat(const std::string& name, const T& x, const U& y, const V& z, const W& w)
+    Program& SetUniformFloat(const UniformName& name, const T& x, const U& y, const V& z, const W& w)
     {
         return SetUniformFloat(GetUniform(name), (float)x, (float)y, (float)z, (float)w);
     }
     
     template <typename T>
-    Program& SetUniform( const std::string& name, const T* values, unsigned count)
+    Program& SetUniform(const UniformName& name, const T* values, unsigned count)
     {
         return SetUniform(GetUniform(name), values, count);
     }
@@ -269,20 +461,166 @@ public:
     Program& SetUniform(const Uniform& uniform, const glm::mat4x4& value);
 #endif
     
+    /// Number of glUniform* calls issued by the setters since link or ResetUniformUpdateCounters()
+    unsigned GetIssuedUniformUpdates();
+    /// Number of setter calls skipped because the uniform already had the value
+    unsigned GetSkippedUniformUpdates();
+    Program& ResetUniformUpdateCounters();
+    
     // helpers
-    unsigned GetNumActiveAttributes()const{ return GetInt(GL_ACTIVE_ATTRIBUTES); };
-    unsigned GetNumActiveUniforms()const{ return GetInt(GL_ACTIVE_UNIFORMS); };
+    unsigned GetNumActiveAttributes();
+    unsigned GetNumActiveUniforms();
     
     /// Define an array of buffers into which outputs from the fragment shader data will be written.
     /// Uses glDrawBuffers() and setting persists until you change it.
     static void SetDrawBuffers(unsigned num, DrawBufferType::E type, ...);
     
 private:
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-    static GLuint s_boundProgram;
-#endif
+    /// Takes ownership of the program name
+    explicit Program(GLuint program);
+    
+    struct UniformSlot {
+        unsigned hash;
+        unsigned name; ///< offset in LinkData::uniformNames
+        Uniform location; ///< negative for empty slot
+        bool sharedHash; ///< another entry has the same hash, lookups must compare the names
+    };
+    /// Open-addressing hash table with power of two size, names of the same hash are chained by probing
+    typedef std::vector<UniformSlot> UniformTable;
+    
+    /// Place of a uniform value in the shadow storage
+    struct ShadowSlot {
+        unsigned offset;
+        unsigned end; ///< end of the whole array the value belongs to, 0 if the location is not shadowed
+    };
+    
+    /// Inputs of the link and data built at link time, shared by all copies of the program
+    struct LinkData : public GLObjectData {
+        LinkData() : deferredBindings(false), linkPending(false), linked(false), issuedUniformUpdates(0), skippedUniformUpdates(0) {};
+        
+        /// Shaders attached without being compiled, Link() compiles them
+        std::vector<BaseShader> pendingShaders;
+        /// Shaders compiled by the last LinkAsync(), for reporting errors
+        std::vector<BaseShader> compilingShaders;
+        /// Shaders attached before the GL program was created, attached by ApplyDeferred()
+        std::vector<BaseShader> deferredShaders;
+        /// BindAttribLocation was called before the GL program was created
+        bool deferredBindings;
+        /// LinkAsync() was called and FinishLink() wasn't yet
+        bool linkPending;
+        /// Attribute bindings made by BindAttribLocation, for GetSourceHash
+        std::vector<std::pair<GLuint, std::string> > attribBindings;
+        
+        /// True if the following members were built for the current link
+        bool linked;
+        ProgramReflection reflection;
+        UniformTable uniformTable;
+        /// Names of the table entries, including "name" and "name[i]" of arrays which the reflection doesn't have
+        std::vector<char> uniformNames;
+        /// Shadow copy of uniform values, indexed by location through shadowSlots
+        std::vector<unsigned char> shadow;
+        std::vector<ShadowSlot> shadowSlots;
+        
+        unsigned issuedUniformUpdates;
+        unsigned skippedUniformUpdates;
+    };
+    
+    /// Returns the data, creating it if needed
+    LinkData* GetData();
+    /// Returns link data, building it if the program was linked without Link() of this object. NULL if not linked.
+    LinkData* GetLinkData();
+    /// Attaches shaders and binds attributes recorded before the GL program was created
+    void ApplyDeferred();
+    /// Builds the reflection, the table of uniform locations and the shadow storage of uniform values
+    void BuildLinkData();
+    void BuildReflection(ProgramReflection& reflection);
+    static void AddShadowSlot(LinkData* data, Uniform location, unsigned offset, unsigned end);
+    
+    /// Returns false if the value equals the shadow copy and the GL call can be skipped, updates the copy otherwise
+    bool UpdateShadow(const Uniform& uniform, const void* value, unsigned size);
+};
+
+/** Program pipeline object combining stages of separable programs, see Program::SetSeparable().
+
+Stages are mixed at bind time without linking a program for every combination.
+Uniforms are set per stage program, use the stage setters or GetStage().
+Requires Renderer::HasSeparateShaderObjects().
+*/
+class ProgramPipeline : public GLObject
+{
+public:
+    ProgramPipeline();
+    
+    /// Use the stages of the separable program in the pipeline, replacing programs of these stages
+    ProgramPipeline& UseProgramStages(GLbitfield stages, const Program& program);
+    /// Remove programs of the stages from the pipeline
+    ProgramPipeline& ClearStages(GLbitfield stages);
+    /// Returns program of the stage, NULL if the pipeline doesn't use the stage
+    Program* GetStage(ProgramStage::E stage);
+    /// Returns true if a program is used for the stage
+    bool HasStage(ProgramStage::E stage);
+    
+    /// Bind the pipeline, unbinding a program bound by Program::Use() which would override it
+    ProgramPipeline& Bind();
+    /// Bind no pipeline
+    static void BindNone();
+    ProgramPipeline& Unbind(){ BindNone(); return *this; };
+    
+    /// Validates the pipeline can run in the current GL state
+    bool Validate();
+    /// Returns validation info log of the pipeline
+    std::string GetInfoLog()const;
     
-    bool _valid;
+    template <typename T>
+    ProgramPipeline& SetUniform(ProgramStage::E stage, const UniformName& name, const T& value)
+    {
+        Program* program = GetUsedStage(stage);
+        if (program) {
+            program->SetUniform(name, value);
+        }
+        return *this;
+    }
+    template <typename T>
+    ProgramPipeline& SetUniform(ProgramStage::E stage, const UniformName& name, const T* values, unsigned count)
+    {
+        Program* program = GetUsedStage(stage);
+        if (program) {
+            program->SetUniform(name, values, count);
+        }
+        return *this;
+    }
+    ProgramPipeline& SetUniformInt(ProgramStage::E stage, const UniformName& name, int value)
+    {
+        Program* program = GetUsedStage(stage);
+        if (program) {
+            program->SetUniformInt(program->GetUniform(name), value);
+        }
+        return *this;
+    }
+    ProgramPipeline& SetUniformFloat(ProgramStage::E stage, const UniformName& name, float value)
+    {
+        Program* program = GetUsedStage(stage);
+        if (program) {
+            program->SetUniformFloat(program->GetUniform(name), value);
+        }
+        return *this;
+    }
+    ProgramPipeline& SetUniformTextureUnit(ProgramStage::E stage, const UniformName& name, int unit)
+    {
+        return SetUniformInt(stage, name, unit);
+    }
+    
+private:
+    /// Programs of the stages, shared by all copies of the pipeline
+    struct PipelineData : public GLObjectData {
+        std::vector<Program> programs;
+        /// Stage bits used from each program
+        std::vector<GLbitfield> stages;
+    };
+    
+    PipelineData* GetData();
+    /// GetStage() for setters, printing an error if the stage isn't used
+    Program* GetUsedStage(ProgramStage::E stage);
 };
 
 #define GLSL(verStr, x) "#version " verStr "\n" #x
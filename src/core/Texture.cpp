@@ -4,10 +4,6 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 -*/
 #include "Texture.h"
 
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-unsigned TextureUnit::s_activeUnit = 0;
-#endif
-
 TextureUnit::TextureUnit(unsigned unit)
 : _unit(unit)
 {
@@ -20,9 +16,8 @@ TextureUnit::TextureUnit(unsigned unit)
 TextureUnit& TextureUnit::Bind()
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_activeUnit == _unit)
+    if (!GLStateCache::Current().SetActiveTexture(_unit))
         return *this;
-    s_activeUnit = _unit;
 #endif
     
     glActiveTexture(GL_TEXTURE0 + _unit);
@@ -35,9 +30,8 @@ void TextureUnit::BindNone()
     // without replacing active texture for lower units
     unsigned unitToSet = Renderer::GetMaxTextureUnits()-1;
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_activeUnit == unitToSet)
+    if (!GLStateCache::Current().SetActiveTexture(unitToSet))
         return;
-    s_activeUnit = unitToSet;
 #endif
     
     glActiveTexture(GL_TEXTURE0 + unitToSet);
@@ -75,25 +69,40 @@ TextureUnit& TextureUnit::SetFilter(GLenum target, MinFilterMode::E minifying, M
 
 //----------------------------------------------------------
 
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-BaseTexture::TargetTextureMap BaseTexture::s_boundTextureToTarget;
+/// Creates names of textures deferred by the constructor, target 0 only generates the names
+static void CreateTextures(GLenum target, GLsizei n, GLuint* names)
+{
+#ifdef GLFK_BATCH_GL_NAMES
+    for (GLsizei i=0; i<n; i++) {
+        names[i] = GLStateCache::Current().GetNamePool().GenTexture(target);
+    }
+#else
+    if (target != 0 && Renderer::HasDirectStateAccess()) {
+        glCreateTextures(target, n, names);
+    } else {
+        glGenTextures(n, names);
+    }
 #endif
+}
 
 BaseTexture::BaseTexture()
-: _valid(false)
 {
-    GLuint obj;
-    glGenTextures(1, &obj);
-    
-    AssignGLObject(obj, glDeleteTextures);
+    // created up front, copies on other threads (e.g. of extra/UploadWorker) mustn't race to attach it
+    SetSharedData(new TextureData);
+    DeferGLObject(CreateTextures, 0, glDeleteTextures);
+}
+
+BaseTexture::BaseTexture(GLenum target)
+{
+    SetSharedData(new TextureData);
+    DeferGLObject(CreateTextures, target, glDeleteTextures);
 }
 
 BaseTexture& BaseTexture::Bind(GLenum target)
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundTextureToTarget[target] == *this)
+    if (!GLStateCache::Current().SetTexture(target, *this))
         return *this;
-    s_boundTextureToTarget[target] = *this;
 #endif
     glBindTexture(target, *this);
     return *this;
@@ -102,9 +111,8 @@ BaseTexture& BaseTexture::Bind(GLenum target)
 void BaseTexture::BindNone(GLenum target)
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundTextureToTarget[target] == 0)
+    if (!GLStateCache::Current().SetTexture(target, 0))
         return;
-    s_boundTextureToTarget[target] = 0;
 #endif
     glBindTexture(target, 0);
 }
@@ -115,6 +123,11 @@ BaseTexture& BaseTexture::GenerateMipmap(GLenum target)
     assert( IsValid() ); // texture must be valid (hold data)
 #endif
     
+    if (Renderer::HasDirectStateAccess()) {
+        glGenerateTextureMipmap(*this);
+        return *this;
+    }
+    
     GLFK_AUTO_BIND(target);
     glGenerateMipmap(target);
     GLFK_AUTO_UNBIND(target);
@@ -127,15 +140,43 @@ Texture& Texture::SetTextureUnit(TextureUnit unit)
 {
     _unit = unit;
     
+    if (Renderer::HasDirectStateAccess()) {
+#ifdef GLFK_PREVENT_MULTIPLE_BIND
+        if (!GLStateCache::Current().SetTexture(unit, _target, *this))
+            return *this;
+#endif
+        glBindTextureUnit(unit, *this);
+        return *this;
+    }
+    
     unit.Bind();
     
-    glBindTexture(_target, *this); // force-bind
+    Bind(); // bindings are tracked per unit, so this binds to the new unit
     
     // set at last unit to allow independent unbinds and binds
     // without replacing active texture for lower units
     unit.Unbind();
     
-    GLFK_AUTO_UNBIND(); // because of force-bind earlier
+    return *this;
+}
+
+GLint Texture::GetInt(GLenum pname)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        GLint out;
+        glGetTextureParameteriv(*this, pname, &out);
+        return out;
+    }
+    return _unit.GetInt(_target, pname);
+}
+
+Texture& Texture::SetInt(GLenum pname, GLint value)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        glTextureParameteri(*this, pname, value);
+        return *this;
+    }
+    _unit.SetInt(_target, pname, value);
     return *this;
 }
 
@@ -145,7 +186,20 @@ Texture1D& Texture1D::SetImage(GLint level, InternalFormat::E internalFormat, GL
 {
     GLFK_AUTO_BIND();
     glTexImage1D(_target, level, internalFormat, width, 0, format, type, data);
-    _valid = true;
+    SetValid();
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
+Texture1D& Texture1D::SetSubImage(GLint level, GLint xoffset, GLsizei width, PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        glTextureSubImage1D(*this, level, xoffset, width, format, type, data);
+        return *this;
+    }
+    
+    GLFK_AUTO_BIND();
+    glTexSubImage1D(_target, level, xoffset, width, format, type, data);
     GLFK_AUTO_UNBIND();
     return *this;
 }
@@ -157,7 +211,21 @@ Texture2D& Texture2D::SetImage(GLint level, InternalFormat::E internalFormat, GL
 {
     GLFK_AUTO_BIND();
     glTexImage2D(_target, level, internalFormat, width, height, 0, format, type, data);
-    _valid = true;
+    SetValid();
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
+Texture2D& Texture2D::SetSubImage(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                                PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        glTextureSubImage2D(*this, level, xoffset, yoffset, width, height, format, type, data);
+        return *this;
+    }
+    
+    GLFK_AUTO_BIND();
+    glTexSubImage2D(_target, level, xoffset, yoffset, width, height, format, type, data);
     GLFK_AUTO_UNBIND();
     return *this;
 }
@@ -169,7 +237,21 @@ Texture3D& Texture3D::SetImage(GLint level, InternalFormat::E internalFormat, GL
 {
     GLFK_AUTO_BIND();
     glTexImage3D(_target, level, internalFormat, width, height, depth, 0, format, type, data);
-    _valid = true;
+    SetValid();
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
+Texture3D& Texture3D::SetSubImage(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height,
+                    GLsizei depth, PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        glTextureSubImage3D(*this, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
+        return *this;
+    }
+    
+    GLFK_AUTO_BIND();
+    glTexSubImage3D(_target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
     GLFK_AUTO_UNBIND();
     return *this;
 }
@@ -181,7 +263,22 @@ TextureCube& TextureCube::SetImage(CubeFace::E face, GLint level, InternalFormat
 {
     GLFK_AUTO_BIND();
     glTexImage2D(face, level, internalFormat, width, height, 0, format, type, data);
-    _valid = true;
+    SetValid();
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
+TextureCube& TextureCube::SetSubImage(CubeFace::E face, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                                        PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        // DSA addresses cube faces as layers
+        glTextureSubImage3D(*this, level, xoffset, yoffset, face - CubeFace::POSITIVE_X, width, height, 1, format, type, data);
+        return *this;
+    }
+    
+    GLFK_AUTO_BIND();
+    glTexSubImage2D(face, level, xoffset, yoffset, width, height, format, type, data);
     GLFK_AUTO_UNBIND();
     return *this;
 }
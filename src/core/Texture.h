@@ -4,7 +4,6 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 -*/
 #pragma once
 
-#include <map>
 #include "Renderer.h"
 #include "Utils.h"
 
@@ -56,9 +55,6 @@ public:
     TextureUnit& SetFilter(GLenum target, MinFilterMode::E minifying, MagFilterMode::E magnifying);
     
 protected:
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-    static unsigned s_activeUnit;
-#endif
     unsigned _unit;
 };
 
@@ -67,12 +63,18 @@ class BaseTexture : public GLObject
 {
 public:
     BaseTexture();
+    /// Texture for the target. The target is needed to create the texture when using Direct State Access.
+    BaseTexture(GLenum target);
     
     BaseTexture& Bind(GLenum target);
     static void BindNone(GLenum target);
     BaseTexture& Unbind(GLenum target){ BindNone(target); return *this; };
     
-    bool IsValid()const{ return _valid; };
+    /// Returns true if the texture got its image, shared by all copies (e.g. one uploaded by extra/UploadWorker)
+    bool IsValid()const{
+        const TextureData* data = (const TextureData*)GetSharedData();
+        return data && data->valid;
+    };
     BaseTexture& GenerateMipmap(GLenum target);
     
     // helpers
@@ -81,22 +83,27 @@ public:
     /// Sets the texture pixel data row alignment. GLFK default 1 (OpenGL default 4).
     static void SetUnpackAlignment(unsigned align){ glPixelStorei(GL_UNPACK_ALIGNMENT, align); };
     
-private:
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-    typedef std::map<GLenum, GLuint> TargetTextureMap;
-    static TargetTextureMap s_boundTextureToTarget;
+protected:
+    struct TextureData : public GLObjectData {
+        TextureData() : valid(false) {};
+        
+#ifdef GLFK_THREAD_SAFE_REFS
+        std::atomic<bool> valid;
+#else
+        bool valid;
 #endif
+    };
     
-protected:
-    bool _valid;
+    /// Mark the texture valid for all copies
+    void SetValid(){ ((TextureData*)GetSharedData())->valid = true; };
 };
 
 /// Texture for a specific target
 class Texture : public BaseTexture
 {
 public:
-    Texture(GLenum target) : _target(target) {};
-    Texture(GLenum target, TextureUnit unit) : _target(target) { SetTextureUnit(unit); };
+    Texture(GLenum target) : BaseTexture(target), _target(target) {};
+    Texture(GLenum target, TextureUnit unit) : BaseTexture(target), _target(target) { SetTextureUnit(unit); };
     
     Texture& Bind() { return (Texture&)BaseTexture::Bind(_target); };
     Texture& Unbind() { return (Texture&)BaseTexture::Unbind(_target); };
@@ -105,6 +112,10 @@ public:
     GLenum GetTarget()const{ return _target; };
     GLint GetInt(TextureUnit& unit, GLenum pname){ return unit.GetInt(_target, pname); };
     Texture& SetInt(TextureUnit& unit, GLenum pname, GLint value){ unit.SetInt(_target, pname, value); return *this; };
+    /// Get texture parameter, directly when using Direct State Access, otherwise through the texture unit of this texture
+    GLint GetInt(GLenum pname);
+    /// Set texture parameter, directly when using Direct State Access, otherwise through the texture unit of this texture
+    Texture& SetInt(GLenum pname, GLint value);
     Texture& SetTextureUnit(TextureUnit unit);
     TextureUnit& GetTextureUnit(){ return _unit; };
     
@@ -119,9 +130,11 @@ public:
      
     Initially are all wrap modes set to WrapMode::REPEAT.
     */
-    Texture& SetWrap(WrapMode::E s){ _unit.SetWrap(_target, s); return *this; };
-    Texture& SetWrap(WrapMode::E s, WrapMode::E t){ _unit.SetWrap(_target, s, t); return *this; };
-    Texture& SetWrap(WrapMode::E s, WrapMode::E t, WrapMode::E r){ _unit.SetWrap(_target, s, t, r); return *this; };
+    Texture& SetWrap(WrapMode::E s){ return SetInt(GL_TEXTURE_WRAP_S, s); };
+    Texture& SetWrap(WrapMode::E s, WrapMode::E t){ return SetInt(GL_TEXTURE_WRAP_S, s).SetInt(GL_TEXTURE_WRAP_T, t); };
+    Texture& SetWrap(WrapMode::E s, WrapMode::E t, WrapMode::E r){
+        return SetInt(GL_TEXTURE_WRAP_S, s).SetInt(GL_TEXTURE_WRAP_T, t).SetInt(GL_TEXTURE_WRAP_R, r);
+    };
     
     /** Set texture filtering mode
     
@@ -130,7 +143,9 @@ public:
      
     The initial value of minifying is E::MIN_NEAREST_MIPMAP_LINEAR, for magnifying E::MAG_LINEAR
     */
-    Texture& SetFilter(MinFilterMode::E minifying, MagFilterMode::E magnifying){ _unit.SetFilter(_target, minifying, magnifying); return *this; };
+    Texture& SetFilter(MinFilterMode::E minifying, MagFilterMode::E magnifying){
+        return SetInt(GL_TEXTURE_MIN_FILTER, minifying).SetInt(GL_TEXTURE_MAG_FILTER, magnifying);
+    };
     
 protected:
     GLenum _target;
@@ -150,6 +165,9 @@ public:
     /// \param type Data type of each channel
     Texture1D& SetImage(GLint level, InternalFormat::E internalFormat, GLsizei width,
                         PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data);
+    /// Updates part of the texture image set by SetImage. Doesn't need to bind the texture when using Direct State Access.
+    Texture1D& SetSubImage(GLint level, GLint xoffset, GLsizei width,
+                        PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data);
     
     // helpers
     Texture1D& SetEmptyImage(InternalFormat::E internalFormat, GLsizei width, PixelDataFormat::E format/* = PixelDataFormat::RGBA*/) {
@@ -170,6 +188,9 @@ public:
     /// \param type Data type of each channel
     Texture2D& SetImage(GLint level, InternalFormat::E internalFormat, GLsizei width, GLsizei height,
                         PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data);
+    /// Updates part of the texture image set by SetImage. Doesn't need to bind the texture when using Direct State Access.
+    Texture2D& SetSubImage(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                        PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data);
 
     // helpers
     Texture2D& SetEmptyImage(InternalFormat::E internalFormat, GLsizei width, GLsizei height) {
@@ -190,6 +211,9 @@ public:
     /// \param type Data type of each channel
     Texture3D& SetImage(GLint level, InternalFormat::E internalFormat, GLsizei width, GLsizei height, GLsizei depth,
                         PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data);
+    /// Updates part of the texture image set by SetImage. Doesn't need to bind the texture when using Direct State Access.
+    Texture3D& SetSubImage(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth,
+                        PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data);
     
     // helpers
     Texture3D& SetEmptyImage(InternalFormat::E internalFormat, GLsizei width, GLsizei height, GLsizei depth) {
@@ -210,6 +234,9 @@ public:
     /// \param type Data type of each channel
     TextureCube& SetImage(CubeFace::E face, GLint level, InternalFormat::E internalFormat, GLsizei width, GLsizei height,
                             PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data);
+    /// Updates part of the face image set by SetImage. Doesn't need to bind the texture when using Direct State Access.
+    TextureCube& SetSubImage(CubeFace::E face, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                            PixelDataFormat::E format, PixelDataType::E type, const GLvoid * data);
     
     // helpers
     TextureCube& SetEmptyImage(CubeFace::E face, InternalFormat::E internalFormat, GLsizei width, GLsizei height) {
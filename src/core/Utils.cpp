@@ -9,6 +9,12 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 #include <sys/stat.h>
 #include <stdlib.h>
 
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
 std::string ReadFile(const char* path)
 {
     struct stat st;
@@ -32,6 +38,50 @@ std::string ReadFile(const char* path)
     return outBuff;
 }
 
+MappedFile::MappedFile(const char* path)
+: _data(NULL), _size(0)
+{
+#ifdef _WIN32
+    _buffer = ReadFile(path);
+    if (!_buffer.empty()) {
+        _data = _buffer.data();
+        _size = _buffer.size() - 1; // ReadFile appends the terminating zero
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            _data = (const char*)ptr;
+            _size = st.st_size;
+        }
+    }
+    close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (_data) {
+        munmap((void*)_data, _size);
+    }
+#endif
+}
+
+uint64_t Hash64(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i) {
+        seed = (seed ^ p[i]) * 1099511628211ull;
+    }
+    return seed;
+}
+
 const char* GLErrorToString(unsigned error)
 {
     if(error == GL_NO_ERROR) {
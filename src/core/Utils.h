@@ -5,10 +5,45 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 #pragma once
 
 #include <string>
+#include <stddef.h>
+#include <stdint.h>
 
 /// Read the whole file into a string
 std::string ReadFile(const char* path);
 
+/// For marking classes as non-copyable.
+/// This is useful if a class holds data which can't be duplicated in a copy.
+class NoCopy
+{
+protected:
+    NoCopy(){};
+
+private:
+    NoCopy(const NoCopy& other);
+};
+
+/// Read-only view of a whole file, memory mapped where available (read into memory otherwise)
+class MappedFile : public NoCopy
+{
+public:
+    MappedFile(const char* path);
+    ~MappedFile();
+    
+    bool IsValid()const{ return _data != NULL; };
+    const char* GetData()const{ return _data; };
+    size_t GetSize()const{ return _size; };
+    
+private:
+    const char* _data;
+    size_t _size;
+#ifdef _WIN32
+    std::string _buffer;
+#endif
+};
+
+/// 64-bit FNV-1a hash of the data, pass the previous result as seed to hash several pieces
+uint64_t Hash64(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
 /// Convert GL error code to stirng
 const char* GLErrorToString(unsigned error);
 
@@ -28,15 +63,19 @@ void PrintGLErrorImpl(const char* where);
 # define DebugBreak()
 #endif
 
-/// For marking classes as non-copyable.
-/// This is useful if a class holds data which can't be duplicated in a copy.
-class NoCopy
-{
-protected:
-    NoCopy(){};
+#define GLFK_PACKED __attribute__((packed))
 
-private:
-    NoCopy(const NoCopy& other);
-};
+/// Marks functions which can be evaluated at compile time when the compiler supports it
+#if __cplusplus >= 201103L
+# define GLFK_CONSTEXPR constexpr
+#else
+# define GLFK_CONSTEXPR inline
+#endif
 
-#define GLFK_PACKED __attribute__((packed))
+/// Defined when move constructors and move assignment can be used
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+# define GLFK_HAS_MOVE 1
+# define GLFK_NOEXCEPT noexcept
+#else
+# define GLFK_NOEXCEPT
+#endif
@@ -4,24 +4,26 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 -*/
 #include "VertexArray.h"
 
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-GLuint VertexArray::s_boundArray = 0;
-#endif
+/// Creates names of vertex arrays deferred by the constructor
+static void CreateVertexArrays(GLenum, GLsizei n, GLuint* names)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        glCreateVertexArrays(n, names);
+    } else {
+        glGenVertexArrays(n, names);
+    }
+}
 
 VertexArray::VertexArray()
 {
-    GLuint array;
-    glGenVertexArrays(1, &array);
-    
-    AssignGLObject(array, glDeleteVertexArrays);
+    DeferGLObject(CreateVertexArrays, 0, glDeleteVertexArrays);
 }
 
 VertexArray& VertexArray::Bind()
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundArray == *this)
+    if (!GLStateCache::Current().SetVertexArray(*this))
         return *this;
-    s_boundArray = *this;
 #endif
     
     glBindVertexArray(*this);
@@ -30,9 +32,8 @@ VertexArray& VertexArray::Bind()
 void VertexArray::BindNone()
 {
 #ifdef GLFK_PREVENT_MULTIPLE_BIND
-    if (s_boundArray == 0)
+    if (!GLStateCache::Current().SetVertexArray(0))
         return;
-    s_boundArray = 0;
 #endif
     
     glBindVertexArray(0);
@@ -40,6 +41,15 @@ void VertexArray::BindNone()
 
 VertexArray& VertexArray::EnableAttribArray(GLuint index, bool enable)
 {
+    if (Renderer::HasDirectStateAccess()) {
+        if (enable) {
+            glEnableVertexArrayAttrib(*this, index);
+        } else {
+            glDisableVertexArrayAttrib(*this, index);
+        }
+        return *this;
+    }
+    
     GLFK_AUTO_BIND();
     if (enable) {
         glEnableVertexAttribArray(index);
@@ -50,6 +60,20 @@ VertexArray& VertexArray::EnableAttribArray(GLuint index, bool enable)
     return *this;
 }
 
+VertexArray& VertexArray::SetAttribDivisor(GLuint index, GLuint divisor)
+{
+    if (Renderer::HasDirectStateAccess()) {
+        // ArrayBuffer uses binding point with the same index as the attribute
+        glVertexArrayBindingDivisor(*this, index, divisor);
+        return *this;
+    }
+    
+    GLFK_AUTO_BIND();
+    glVertexAttribDivisorARB(index, divisor); // core since GL 3.3, loaded through ARB_instanced_arrays
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
 VertexArray& VertexArray::DrawElements(DrawMode::E mode, GLsizei count, IndicesType::E type, const GLvoid * indices)
 {
     GLFK_AUTO_BIND();
@@ -65,3 +89,66 @@ VertexArray& VertexArray::DrawArrays(DrawMode::E mode, GLint first, GLsizei coun
     GLFK_AUTO_UNBIND();
     return *this;
 }
+
+VertexArray& VertexArray::DrawElementsInstanced(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                const GLvoid * indices, GLsizei instances)
+{
+    GLFK_AUTO_BIND();
+    Renderer::DrawElementsInstanced(mode, count, type, indices, instances);
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
+VertexArray& VertexArray::DrawArraysInstanced(DrawMode::E mode, GLint first, GLsizei count, GLsizei instances)
+{
+    GLFK_AUTO_BIND();
+    Renderer::DrawArraysInstanced(mode, first, count, instances);
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
+VertexArray& VertexArray::DrawElementsInstancedBaseInstance(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                            const GLvoid * indices, GLsizei instances,
+                                                            GLuint baseInstance)
+{
+    GLFK_AUTO_BIND();
+    Renderer::DrawElementsInstancedBaseInstance(mode, count, type, indices, instances, baseInstance);
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
+VertexArray& VertexArray::DrawArraysInstancedBaseInstance(DrawMode::E mode, GLint first, GLsizei count,
+                                                          GLsizei instances, GLuint baseInstance)
+{
+    GLFK_AUTO_BIND();
+    Renderer::DrawArraysInstancedBaseInstance(mode, first, count, instances, baseInstance);
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
+VertexArray& VertexArray::DrawElementsBaseVertex(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                 const GLvoid * indices, GLint baseVertex)
+{
+    GLFK_AUTO_BIND();
+    Renderer::DrawElementsBaseVertex(mode, count, type, indices, baseVertex);
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
+VertexArray& VertexArray::DrawElementsInstancedBaseVertex(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                          const GLvoid * indices, GLsizei instances, GLint baseVertex)
+{
+    GLFK_AUTO_BIND();
+    Renderer::DrawElementsInstancedBaseVertex(mode, count, type, indices, instances, baseVertex);
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
+
+VertexArray& VertexArray::MultiDrawElementsIndirect(DrawMode::E mode, IndicesType::E type, const GLvoid * indirect,
+                                                    GLsizei drawCount, GLsizei stride)
+{
+    GLFK_AUTO_BIND();
+    Renderer::MultiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+    GLFK_AUTO_UNBIND();
+    return *this;
+}
@@ -12,6 +12,8 @@ class VertexArray : public GLObject
 {
 public:
     VertexArray();
+    /// Vertex array without a GL object (binds 0), for buffers which are never bound as index buffers
+    static VertexArray None(){ return VertexArray(NoObject()); };
 
     VertexArray& Bind();
     static void BindNone();
@@ -19,12 +21,26 @@ public:
 
     /// Enables the specified attribute array
     VertexArray& EnableAttribArray(GLuint index, bool enable=true);
+    /// Advance the attribute once per divisor instances instead of once per vertex (0), requires GL 3.3 or ARB_instanced_arrays
+    VertexArray& SetAttribDivisor(GLuint index, GLuint divisor);
     
     VertexArray& DrawElements(DrawMode::E mode, GLsizei count, IndicesType::E type, const GLvoid * indices = NULL);
     VertexArray& DrawArrays(DrawMode::E mode, GLint first, GLsizei count);
+    VertexArray& DrawElementsInstanced(DrawMode::E mode, GLsizei count, IndicesType::E type, const GLvoid * indices,
+                                       GLsizei instances);
+    VertexArray& DrawArraysInstanced(DrawMode::E mode, GLint first, GLsizei count, GLsizei instances);
+    VertexArray& DrawElementsBaseVertex(DrawMode::E mode, GLsizei count, IndicesType::E type, const GLvoid * indices,
+                                        GLint baseVertex);
+    VertexArray& DrawElementsInstancedBaseVertex(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                 const GLvoid * indices, GLsizei instances, GLint baseVertex);
+    /// Draw records of the bound GL_DRAW_INDIRECT_BUFFER, see Renderer::MultiDrawElementsIndirect
+    VertexArray& MultiDrawElementsIndirect(DrawMode::E mode, IndicesType::E type, const GLvoid * indirect,
+                                           GLsizei drawCount, GLsizei stride = 0);
+    VertexArray& DrawElementsInstancedBaseInstance(DrawMode::E mode, GLsizei count, IndicesType::E type,
+                                                   const GLvoid * indices, GLsizei instances, GLuint baseInstance);
+    VertexArray& DrawArraysInstancedBaseInstance(DrawMode::E mode, GLint first, GLsizei count, GLsizei instances,
+                                                 GLuint baseInstance);
     
 private:
-#ifdef GLFK_PREVENT_MULTIPLE_BIND
-    static GLuint s_boundArray;
-#endif
+    VertexArray(NoObject) : GLObject(NoObject()) {};
 };
@@ -0,0 +1,77 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#include "FramePacer.h"
+
+#define GL_DO_NOT_WARN_IF_MULTI_GL_VERSION_HEADERS_INCLUDED // GLAD simulates gl.h
+#include <GLFW/glfw3.h>
+
+FramePacer::FramePacer(unsigned maxFramesInFlight)
+: _next(0)
+{
+    SetMaxFramesInFlight(maxFramesInFlight);
+    ResetStats();
+}
+
+FramePacer& FramePacer::SetMaxFramesInFlight(unsigned count)
+{
+    if (count < 1) {
+        count = 1;
+    }
+    // the ring order is lost, finish the frames queued so far
+    for (unsigned i=0; i<_fences.size(); i++) {
+        _fences[i].ClientWait();
+    }
+    _fences.clear();
+    _fences.resize(count);
+    _fenceTimes.assign(count, 0.0);
+    _next = 0;
+    return *this;
+}
+
+FramePacer& FramePacer::EndFrame()
+{
+    _fences[_next].Insert();
+    _fenceTimes[_next] = glfwGetTime();
+    _next = (_next + 1) % _fences.size();
+
+    // the oldest fence is of the frame maxFramesInFlight - 1 frames ago, the next frame may start once it's done
+    Fence& oldest = _fences[_next];
+    _lastWait = 0.0;
+    if (oldest.IsInserted()) {
+        double start = glfwGetTime();
+        if (!oldest.IsSignaled()) {
+            _stalls++;
+            oldest.ClientWait();
+        }
+        double end = glfwGetTime();
+        _lastWait = end - start;
+        _gpuLag = end - _fenceTimes[_next];
+    }
+
+    _totalWait += _lastWait;
+    _frames++;
+    return *this;
+}
+
+unsigned FramePacer::GetFramesInFlight()
+{
+    unsigned count = 0;
+    for (unsigned i=0; i<_fences.size(); i++) {
+        if (!_fences[i].IsSignaled()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+FramePacer& FramePacer::ResetStats()
+{
+    _lastWait = 0.0;
+    _totalWait = 0.0;
+    _gpuLag = 0.0;
+    _frames = 0;
+    _stalls = 0;
+    return *this;
+}
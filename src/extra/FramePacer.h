@@ -0,0 +1,55 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "core/Fence.h"
+
+#include <vector>
+
+/** Limits the number of frames queued for the GPU, for a fixed latency instead of the queue depth of the driver
+
+EndFrame() fences the frame and blocks until at most maxFramesInFlight frames are unfinished by the GPU.
+Window::EndFrame() calls it after swapping buffers once the pacer is set by Window::SetFramePacer(), so the
+next frame starts, and samples input, no more than maxFramesInFlight frames ahead of the display.
+1 frame in flight gives the lowest latency, while 2 or more let the CPU and the GPU work in parallel.
+*/
+class FramePacer : public NoCopy
+{
+public:
+    FramePacer(unsigned maxFramesInFlight = 2);
+
+    /// Change the number of frames in flight, at least 1
+    FramePacer& SetMaxFramesInFlight(unsigned count);
+    unsigned GetMaxFramesInFlight()const{ return _fences.size(); };
+
+    /// Fence the frame and wait for the GPU to finish the frame maxFramesInFlight frames ago.
+    /// Call it on the thread of the context after swapping buffers.
+    FramePacer& EndFrame();
+
+    /// Returns number of frames the GPU didn't finish yet, after the last EndFrame
+    unsigned GetFramesInFlight();
+    /// Returns seconds the last EndFrame() blocked the CPU
+    double GetLastWaitTime()const{ return _lastWait; };
+    /// Returns average seconds EndFrame() blocked the CPU since the last ResetStats()
+    double GetAverageWaitTime()const{ return _frames ? _totalWait / _frames : 0.0; };
+    /// Returns seconds between fencing the last frame the pacer waited for and seeing it finished.
+    /// This is how far the GPU trailed the CPU, at most by the time between EndFrame() calls.
+    double GetGpuLag()const{ return _gpuLag; };
+    /// Returns number of frames which had to wait for the GPU
+    unsigned GetStallCount()const{ return _stalls; };
+    FramePacer& ResetStats();
+
+private:
+    /// Fences of the last frames, used as a ring
+    std::vector<Fence> _fences;
+    /// Times the fences were inserted
+    std::vector<double> _fenceTimes;
+    unsigned _next;
+    double _lastWait;
+    double _totalWait;
+    double _gpuLag;
+    unsigned _frames;
+    unsigned _stalls;
+};
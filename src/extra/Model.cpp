@@ -4,7 +4,6 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 -*/
 
 #include "Model.h"
-#include "Shaders.h"
 
 #include <stdio.h>
 
@@ -24,17 +23,45 @@ Model& Model::Draw(DrawMode::E mode)
     return *this;
 }
 
+Model& Model::DrawInstanced(GLsizei instances, DrawMode::E mode)
+{
+    _program.Bind();
+    _vao.DrawElementsInstanced(mode, _ibCount, _ibType, NULL, instances);
+    
+    return *this;
+}
+
+const AttribBinding* Model::GetAttribBindings()
+{
+    static const AttribBinding bindings[] = {
+        { ModelAttribute::POSITION, "a_vPosition" },
+        { ModelAttribute::NORMAL, "a_vNormal" },
+        { ModelAttribute::TANGENT, "a_vTangent" },
+        { ModelAttribute::BITANGENT, "a_vBitangent" },
+        { ModelAttribute::TEXCOORD, "a_vTexCoord" },
+        { ModelAttribute::COLOR, "a_vColor" },
+        { ModelAttribute::INSTANCE_TRANSFORM, "a_mInstance" },
+        { 0, NULL }
+    };
+    return bindings;
+}
+
+Model& Model::SetProgram(BaseShader& vs, BaseShader& fs)
+{
+    _program = ShaderRegistry::Current().GetProgram(vs, fs, GetAttribBindings());
+    _valid = _program.IsValid();
+    
+    return *this;
+}
+
 Model& Model::SetProgram(const Program& prg)
 {
     _program = prg;
     
     // set common attributes
-    _program.BindAttribLocation(ModelAttribute::POSITION, "a_vPosition");
-    _program.BindAttribLocation(ModelAttribute::NORMAL, "a_vNormal");
-    _program.BindAttribLocation(ModelAttribute::TANGENT, "a_vTangent");
-    _program.BindAttribLocation(ModelAttribute::BITANGENT, "a_vBitangent");
-    _program.BindAttribLocation(ModelAttribute::TEXCOORD, "a_vTexCoord");
-    _program.BindAttribLocation(ModelAttribute::COLOR, "a_vColor");
+    for (const AttribBinding* b = GetAttribBindings(); b->name; ++b) {
+        _program.BindAttribLocation(b->index, b->name);
+    }
     
     _valid = _program.Link();
     
@@ -63,6 +90,47 @@ Model& Model::AddVertexBuffer(const VertexBuffer& vb)
 
 //-----------------------------------------------------
 
+InstancedModel::InstancedModel(const Model& model, unsigned maxInstances)
+: _model(model), _instances(_model.GetVAO()), _maxInstances(maxInstances)
+{
+    _transforms.reserve(maxInstances);
+    _instances.SetData(maxInstances * sizeof(glm::mat4), NULL, BufferUsage::STREAM_DRAW);
+    
+    // mat4 attribute is made of 4 vec4 columns
+    for (unsigned i = 0; i < 4; ++i) {
+        GLuint index = ModelAttribute::INSTANCE_TRANSFORM + i;
+        _instances.SetAttribPointer(index, 4, AttribType::FLOAT, false, sizeof(glm::mat4),
+                                    (const GLvoid*)(i * sizeof(glm::vec4)));
+        _instances.SetAttribDivisor(index, 1);
+    }
+}
+
+bool InstancedModel::AddInstance(const glm::mat4& transform)
+{
+    if (_transforms.size() >= _maxInstances) {
+        return false;
+    }
+    _transforms.push_back(transform);
+    return true;
+}
+
+InstancedModel& InstancedModel::Draw(DrawMode::E mode)
+{
+    if (_transforms.empty()) {
+        return *this;
+    }
+    
+    // new storage for every frame, the previous set may still be in use by the GPU
+    _instances.Orphan();
+    _instances.SetSubData(0, _transforms.size() * sizeof(glm::mat4), &_transforms[0]);
+    _model.DrawInstanced(_transforms.size(), mode);
+    _transforms.clear();
+    
+    return *this;
+}
+
+//-----------------------------------------------------
+
 Model::BasicVertex::BasicVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texcoord)
 : position(position), normal(normal), texcoord(texcoord)
 {
@@ -125,8 +193,7 @@ PlaneModel::PlaneModel(float width, float height)
     
     // shader
     
-    Program prg(VertexShaders::NoTransform(), FragmentShaders::RedColor());
-    SetProgram(prg);
+    SetProgram(VertexShaders::NoTransform(), FragmentShaders::RedColor());
 }
 
 //-----------------------------------------------------
@@ -185,8 +252,7 @@ BoxModel::BoxModel(float width, float height, float depth)
     
     // shader
     
-    Program prg(VertexShaders::NoTransform(), FragmentShaders::RedColor());
-    SetProgram(prg);
+    SetProgram(VertexShaders::NoTransform(), FragmentShaders::RedColor());
 }
 
 
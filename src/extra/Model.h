@@ -7,9 +7,11 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 #include "core/Buffer.h"
 #include "core/VertexArray.h"
 #include "core/Shader.h"
+#include "Shaders.h"
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
 
 #include <vector>
 
@@ -20,6 +22,8 @@ GLFK_ENUM(ModelAttribute){
     BITANGENT,
     TEXCOORD,
     COLOR,
+    /// per-instance mat4, occupies 4 attribute locations
+    INSTANCE_TRANSFORM,
 }GLFK_ENUM_END;
 
 class Model
@@ -30,9 +34,16 @@ public:
 public:
     bool IsValid()const{ return _valid; };
     VertexArray& GetVAO(){ return _vao; };
+    Program& GetProgram(){ return _program; };
+    IndicesType::E GetIndexType()const{ return _ibType; };
+    unsigned GetIndexCount()const{ return _ibCount; };
     Model& Draw(DrawMode::E mode = DrawMode::TRIANGLES);
+    Model& DrawInstanced(GLsizei instances, DrawMode::E mode = DrawMode::TRIANGLES);
     
+    /// Bind the model attributes and link the program
     Model& SetProgram(const Program& prg);
+    /// Use program of the shaders shared through ShaderRegistry, linked only by the first model using them
+    Model& SetProgram(BaseShader& vs, BaseShader& fs);
     Model& SetIndexBuffer(const IndexBuffer& ib, IndicesType::E indtype, unsigned count);
     Model& AddVertexBuffer(const VertexBuffer& vb);
     
@@ -58,6 +69,9 @@ public:
     };
     typedef std::vector<ComplexVertex> ComplexVertexArray;
     
+    /// Attribute names bound to ModelAttribute locations
+    static const AttribBinding* GetAttribBindings();
+    
     typedef unsigned int Index;
     typedef std::vector<Index> IndexArray;
     
@@ -77,6 +91,33 @@ private:
     Program _program;
 };
 
+/** Draws many copies of a model in one instanced draw call
+
+Transforms added since the last Draw are streamed to an orphaned instance buffer attached to the model's VAO
+(attribute a_mInstance, ModelAttribute::INSTANCE_TRANSFORM). The model shares its VAO and buffers with the source
+model, so the program of the source model should already use a_mInstance.
+*/
+class InstancedModel
+{
+public:
+    InstancedModel(const Model& model, unsigned maxInstances);
+    
+    /// Add an instance to be drawn by the next Draw, returns false when maxInstances is reached
+    bool AddInstance(const glm::mat4& transform);
+    /// Upload the instances, draw all of them in one call and start collecting a new set
+    InstancedModel& Draw(DrawMode::E mode = DrawMode::TRIANGLES);
+    
+    unsigned GetInstanceCount()const{ return _transforms.size(); };
+    unsigned GetMaxInstances()const{ return _maxInstances; };
+    Model& GetModel(){ return _model; };
+    
+private:
+    Model _model;
+    ArrayBuffer _instances;
+    unsigned _maxInstances;
+    std::vector<glm::mat4> _transforms;
+};
+
 /// Plane oriented in XY
 class PlaneModel : public Model
 {
@@ -0,0 +1,69 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+
+#include "MultiDrawBatch.h"
+
+#include <stdio.h>
+
+MultiDrawBatch::MultiDrawBatch(const VertexArray& vao, IndicesType::E type)
+: _vao(vao), _indirect(_vao), _type(type)
+{
+}
+
+MultiDrawBatch& MultiDrawBatch::Add(GLuint count, GLuint firstIndex, GLint baseVertex, GLuint instances,
+                                    GLuint baseInstance)
+{
+    DrawElementsIndirectCommand cmd = { count, instances, firstIndex, baseVertex, baseInstance };
+    _commands.push_back(cmd);
+    return *this;
+}
+
+MultiDrawBatch& MultiDrawBatch::Clear()
+{
+    _commands.clear();
+    return *this;
+}
+
+MultiDrawBatch& MultiDrawBatch::Draw(DrawMode::E mode)
+{
+    if (_commands.empty()) {
+        return *this;
+    }
+    
+    if (Renderer::HasMultiDrawIndirect()) {
+        // re-specifying the storage lets the driver skip waiting for the previous frame's draws
+        _indirect.SetData(_commands.size() * sizeof(DrawElementsIndirectCommand), &_commands[0],
+                          BufferUsage::STREAM_DRAW);
+        _indirect.Bind(); // source of the indirect draw, not part of the VAO state
+        _vao.MultiDrawElementsIndirect(mode, _type, NULL, _commands.size());
+        GLFK_AUTO_UNBIND_OBJ(_indirect);
+        return *this;
+    }
+    
+    unsigned indexSize = Renderer::GetIndexSize(_type);
+    GLFK_AUTO_BIND_OBJ(_vao);
+    for (size_t i = 0; i < _commands.size(); ++i) {
+        const DrawElementsIndirectCommand& cmd = _commands[i];
+        const GLvoid* indices = (const GLvoid*)((size_t)cmd.firstIndex * indexSize);
+        if (cmd.baseInstance != 0) {
+            if (!Renderer::HasBaseInstance()) {
+                // instanced attributes would start at 0, there is no way to draw this record correctly
+                printf("%s: base instance %u not supported, draw %u skipped\n", __FUNCTION__, cmd.baseInstance,
+                       (unsigned)i);
+                assert(false);
+                continue;
+            }
+            Renderer::DrawElementsInstancedBaseVertexBaseInstance(mode, cmd.count, _type, indices, cmd.instanceCount,
+                                                                  cmd.baseVertex, cmd.baseInstance);
+        } else if (cmd.instanceCount != 1) {
+            Renderer::DrawElementsInstancedBaseVertex(mode, cmd.count, _type, indices, cmd.instanceCount,
+                                                      cmd.baseVertex);
+        } else {
+            Renderer::DrawElementsBaseVertex(mode, cmd.count, _type, indices, cmd.baseVertex);
+        }
+    }
+    GLFK_AUTO_UNBIND_OBJ(_vao);
+    return *this;
+}
@@ -0,0 +1,39 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "core/Buffer.h"
+#include "core/VertexArray.h"
+
+#include <vector>
+
+/** Batch of indexed draws of meshes sharing one VAO with common vertex and index buffers
+
+Draws are collected as DrawElementsIndirectCommand records, uploaded to a DrawIndirrectBuffer and submitted
+by a single glMultiDrawElementsIndirect. Without multi-draw indirect (Renderer::HasMultiDrawIndirect)
+the records are drawn one by one using glDrawElements*BaseVertex.
+*/
+class MultiDrawBatch
+{
+public:
+    MultiDrawBatch(const VertexArray& vao, IndicesType::E type);
+    
+    /// Add draw of count indices starting at firstIndex of the shared index buffer,
+    /// baseVertex is added to every index (first vertex of the mesh in the shared vertex buffer)
+    MultiDrawBatch& Add(GLuint count, GLuint firstIndex, GLint baseVertex, GLuint instances = 1, GLuint baseInstance = 0);
+    /// Remove all draws
+    MultiDrawBatch& Clear();
+    /// Submit all draws, the program must be bound
+    MultiDrawBatch& Draw(DrawMode::E mode = DrawMode::TRIANGLES);
+    
+    unsigned GetDrawCount()const{ return _commands.size(); };
+    const std::vector<DrawElementsIndirectCommand>& GetCommands()const{ return _commands; };
+    
+private:
+    VertexArray _vao;
+    DrawIndirrectBuffer _indirect;
+    IndicesType::E _type;
+    std::vector<DrawElementsIndirectCommand> _commands;
+};
@@ -0,0 +1,73 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+
+#include "ProgramBatch.h"
+
+#include <stdio.h>
+
+ProgramBatch::ProgramBatch()
+: _pending(0)
+{
+    Renderer::SetMaxShaderCompilerThreads(~0u);
+}
+
+unsigned ProgramBatch::Add(const Program& program)
+{
+    _entries.push_back(Entry(program));
+    ++_pending;
+    return _entries.size() - 1;
+}
+
+ProgramBatch& ProgramBatch::Submit()
+{
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        if (!_entries[i].submitted) {
+            _entries[i].program.LinkAsync();
+            _entries[i].submitted = true;
+        }
+    }
+    return *this;
+}
+
+void ProgramBatch::FinishEntry(Entry& entry)
+{
+    if (!entry.program.FinishLink()) {
+        std::string log = entry.program.GetInfoLog();
+        printf("Program %u failed to link: %s\n", (GLuint)entry.program, log.c_str());
+    }
+    entry.finished = true;
+    --_pending;
+}
+
+unsigned ProgramBatch::Poll(unsigned maxBlocking)
+{
+    bool parallel = Renderer::HasParallelShaderCompile();
+    for (size_t i = 0; i < _entries.size() && _pending > 0; ++i) {
+        Entry& entry = _entries[i];
+        if (!entry.submitted || entry.finished) {
+            continue;
+        }
+        if (parallel) {
+            if (entry.program.IsReady()) {
+                FinishEntry(entry);
+            }
+        } else if (maxBlocking > 0) {
+            --maxBlocking;
+            FinishEntry(entry);
+        }
+    }
+    return _pending;
+}
+
+ProgramBatch& ProgramBatch::Finish()
+{
+    Submit();
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        if (!_entries[i].finished) {
+            FinishEntry(_entries[i]);
+        }
+    }
+    return *this;
+}
@@ -0,0 +1,52 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "core/Shader.h"
+
+#include <vector>
+
+/** Links many programs without waiting for each compile and link
+
+Submit() starts all compiles and links up front, Poll() from the frame loop finishes the programs the driver
+reports as complete (GL_COMPLETION_STATUS with KHR/ARB_parallel_shader_compile). Without parallel compile
+the driver can't report progress, so Poll() finishes a limited number of programs per call instead.
+*/
+class ProgramBatch
+{
+public:
+    ProgramBatch();
+    
+    /// Add a program with attached shaders, returns its index in the batch
+    unsigned Add(const Program& program);
+    /// Start compiling and linking all programs added since the last Submit
+    ProgramBatch& Submit();
+    /// Finish ready programs, blocking on at most maxBlocking programs without parallel compile.
+    /// Returns number of programs still pending.
+    unsigned Poll(unsigned maxBlocking = 1);
+    /// Wait for all programs
+    ProgramBatch& Finish();
+    
+    bool IsFinished(unsigned index)const{ return _entries[index].finished; };
+    /// Returns true if the program is finished and linked successfully
+    bool IsValid(unsigned index)const{ return _entries[index].finished && _entries[index].program.IsValid(); };
+    Program& GetProgram(unsigned index){ return _entries[index].program; };
+    unsigned GetCount()const{ return _entries.size(); };
+    unsigned GetPendingCount()const{ return _pending; };
+    
+private:
+    struct Entry {
+        Entry(const Program& program) : program(program), submitted(false), finished(false) {};
+        
+        Program program;
+        bool submitted;
+        bool finished;
+    };
+    
+    void FinishEntry(Entry& entry);
+    
+    std::vector<Entry> _entries;
+    unsigned _pending;
+};
@@ -0,0 +1,138 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+
+#include "ProgramCache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifdef _WIN32
+# include <io.h>
+# define unlink _unlink
+#else
+# include <unistd.h>
+#endif
+
+/// Header of a cache file, followed by the binary
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+    uint64_t checksum;
+};
+
+static const char s_magic[4] = { 'G', 'L', 'F', 'K' };
+static const uint32_t s_version = 1;
+
+//-----------------------------------------------------
+
+ProgramCache::ProgramCache(const std::string& directory)
+: _directory(directory), _driverHash(0), _hits(0), _misses(0), _invalidated(0)
+{
+    const char* renderer = Renderer::GetString(GL_RENDERER);
+    const char* version = Renderer::GetString(GL_VERSION);
+    _driverHash = Hash64(renderer, strlen(renderer) + 1);
+    _driverHash = Hash64(version, strlen(version) + 1, _driverHash);
+}
+
+std::string ProgramCache::GetPath(uint64_t key)const
+{
+    char name[32];
+    sprintf(name, "%016llx.glbin", (unsigned long long)key);
+    return _directory + "/" + name;
+}
+
+bool ProgramCache::Link(Program& program)
+{
+    if (!IsSupported()) {
+        return program.Link();
+    }
+    
+    uint64_t sourceHash = program.GetSourceHash();
+    if (sourceHash == Program::UNCACHEABLE) {
+        ++_misses;
+        return program.Link();
+    }
+    uint64_t key = Hash64(&_driverHash, sizeof(_driverHash), sourceHash);
+    if (Load(program, key)) {
+        ++_hits;
+        return true;
+    }
+    
+    ++_misses;
+    program.SetBinaryRetrievable(true);
+    if (!program.Link()) {
+        return false;
+    }
+    Store(program, key);
+    return true;
+}
+
+bool ProgramCache::Load(Program& program, uint64_t key)
+{
+    std::string path = GetPath(key);
+    bool valid;
+    {
+        MappedFile file(path.c_str());
+        if (!file.IsValid()) {
+            return false; // not cached
+        }
+        
+        const ProgramCacheHeader* header = (const ProgramCacheHeader*)file.GetData();
+        const char* binary = file.GetData() + sizeof(ProgramCacheHeader);
+        valid = file.GetSize() >= sizeof(ProgramCacheHeader)
+            && !memcmp(header->magic, s_magic, sizeof(s_magic))
+            && header->version == s_version
+            && header->key == key
+            && header->length == file.GetSize() - sizeof(ProgramCacheHeader)
+            && header->checksum == Hash64(binary, header->length);
+        
+        // the driver rejects binaries of other driver builds even with the same version string
+        valid = valid && program.ProgramBinary(header->format, binary, header->length);
+    }
+    
+    if (!valid) {
+        printf("%s: invalidating %s\n", __FUNCTION__, path.c_str());
+        unlink(path.c_str());
+        ++_invalidated;
+    }
+    return valid;
+}
+
+void ProgramCache::Store(Program& program, uint64_t key)
+{
+    std::vector<unsigned char> binary;
+    GLenum format;
+    if (!program.GetProgramBinary(binary, format)) {
+        return;
+    }
+    
+    ProgramCacheHeader header;
+    memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = s_version;
+    header.key = key;
+    header.format = format;
+    header.length = binary.size();
+    header.checksum = Hash64(&binary[0], binary.size());
+    
+    // write a temporary file and rename it, so other processes never map a partial entry
+    std::string path = GetPath(key);
+    std::string tmpPath = path + ".tmp";
+    FILE* fp = fopen(tmpPath.c_str(), "wb");
+    if (!fp) {
+        printf("%s: unable to write %s\n", __FUNCTION__, tmpPath.c_str());
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+        && fwrite(&binary[0], binary.size(), 1, fp) == 1;
+    ok = (fclose(fp) == 0) && ok;
+    
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+    }
+}
@@ -0,0 +1,44 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "core/Shader.h"
+
+#include <string>
+
+/** On-disk cache of linked program binaries
+
+Entries are keyed by a hash of the shader sources, attribute bindings and the GL_RENDERER and GL_VERSION strings,
+so a driver update produces new keys. Each entry is one file read through a memory mapping and checked against
+its header and checksum; corrupt entries or binaries rejected by the driver are deleted and the program is linked.
+*/
+class ProgramCache
+{
+public:
+    /// \param directory Existing directory for the cache files
+    ProgramCache(const std::string& directory);
+    
+    /// Restore the program from the cache or link it and store its binary. Returns the link status like Program::Link.
+    bool Link(Program& program);
+    
+    /// Returns true if the driver supports program binaries, otherwise Link only links
+    static bool IsSupported(){ return Renderer::HasProgramBinary(); };
+    
+    unsigned GetHits()const{ return _hits; };
+    unsigned GetMisses()const{ return _misses; };
+    /// Returns number of corrupt or stale entries deleted
+    unsigned GetInvalidated()const{ return _invalidated; };
+    
+private:
+    std::string GetPath(uint64_t key)const;
+    bool Load(Program& program, uint64_t key);
+    void Store(Program& program, uint64_t key);
+    
+    std::string _directory;
+    uint64_t _driverHash;
+    unsigned _hits;
+    unsigned _misses;
+    unsigned _invalidated;
+};
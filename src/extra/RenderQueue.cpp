@@ -0,0 +1,169 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+
+#include "RenderQueue.h"
+#include "Model.h"
+
+RenderPacket::RenderPacket()
+: program(NULL), vao(NULL), mode(DrawMode::TRIANGLES), count(0), type(IndicesType::UNSIGNED_INT), indices(NULL),
+  depth(0), layer(0)
+{
+    for (unsigned i = 0; i < GLFK_RENDER_QUEUE_TEXTURES; ++i) {
+        textures[i] = NULL;
+    }
+}
+
+//-----------------------------------------------------
+
+RenderQueue::RenderQueue()
+{
+}
+
+RenderPacket& RenderQueue::Add(Program& program, VertexArray& vao, GLsizei count, IndicesType::E type, float depth,
+                               unsigned char layer)
+{
+    _packets.push_back(RenderPacket());
+    RenderPacket& packet = _packets.back();
+    packet.program = &program;
+    packet.vao = &vao;
+    packet.count = count;
+    packet.type = type;
+    packet.depth = depth;
+    packet.layer = layer;
+    return packet;
+}
+
+RenderPacket& RenderQueue::Add(Model& model, float depth, unsigned char layer)
+{
+    return Add(model.GetProgram(), model.GetVAO(), model.GetIndexCount(), model.GetIndexType(), depth, layer);
+}
+
+RenderQueue& RenderQueue::Add(const RenderPacket& packet)
+{
+    _packets.push_back(packet);
+    return *this;
+}
+
+RenderQueue& RenderQueue::Clear()
+{
+    _packets.clear();
+    return *this;
+}
+
+uint64_t RenderQueue::MakeKey(const RenderPacket& p)
+{
+    // layer:8 | program:14 | textures:14 | vao:12 | depth:16
+    unsigned textures = 0;
+    for (unsigned i = 0; i < GLFK_RENDER_QUEUE_TEXTURES; ++i) {
+        textures = textures * 31 + (p.textures[i] ? (GLuint)*p.textures[i] : 0);
+    }
+    textures ^= textures >> 14;
+    
+    float depth = p.depth < 0 ? 0 : (p.depth > 1 ? 1 : p.depth);
+    
+    uint64_t key = p.layer;
+    key = (key << 14) | ((GLuint)*p.program & 0x3FFF);
+    key = (key << 14) | (textures & 0x3FFF);
+    key = (key << 12) | ((GLuint)*p.vao & 0xFFF);
+    key = (key << 16) | (unsigned)(depth * 0xFFFF);
+    return key;
+}
+
+void RenderQueue::Sort()
+{
+    // LSD radix sort by bytes, skipping bytes equal in all keys
+    _temp.resize(_items.size());
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+        unsigned counts[256] = { 0 };
+        for (size_t i = 0; i < _items.size(); ++i) {
+            ++counts[(_items[i].key >> shift) & 0xFF];
+        }
+        if (counts[(_items[0].key >> shift) & 0xFF] == _items.size()) {
+            continue;
+        }
+        
+        unsigned offset = 0;
+        for (unsigned b = 0; b < 256; ++b) {
+            unsigned count = counts[b];
+            counts[b] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < _items.size(); ++i) {
+            _temp[counts[(_items[i].key >> shift) & 0xFF]++] = _items[i];
+        }
+        _items.swap(_temp);
+    }
+}
+
+void RenderQueue::CountSwitches(RenderQueueStats& stats, bool sorted)const
+{
+    // same state tracking as Submit
+    stats = RenderQueueStats();
+    GLuint program = 0, vao = 0;
+    GLuint textures[GLFK_RENDER_QUEUE_TEXTURES] = { 0 };
+    for (size_t i = 0; i < _packets.size(); ++i) {
+        const RenderPacket& p = _packets[sorted ? _items[i].index : i];
+        if (*p.program != program) {
+            program = *p.program;
+            ++stats.programSwitches;
+        }
+        if (*p.vao != vao) {
+            vao = *p.vao;
+            ++stats.vaoSwitches;
+        }
+        for (unsigned t = 0; t < GLFK_RENDER_QUEUE_TEXTURES; ++t) {
+            if (p.textures[t] && *p.textures[t] != textures[t]) {
+                textures[t] = *p.textures[t];
+                ++stats.textureSwitches;
+            }
+        }
+    }
+}
+
+RenderQueue& RenderQueue::Submit()
+{
+    if (_packets.empty()) {
+        _unsorted = _sorted = RenderQueueStats();
+        return *this;
+    }
+    
+    _items.resize(_packets.size());
+    for (size_t i = 0; i < _packets.size(); ++i) {
+        _items[i].key = MakeKey(_packets[i]);
+        _items[i].index = i;
+    }
+    CountSwitches(_unsorted, false);
+    Sort();
+    CountSwitches(_sorted, true);
+    
+    // units keep their textures between packets, so a packet not using a unit doesn't unbind it
+    GLuint program = 0, vao = 0;
+    GLuint textures[GLFK_RENDER_QUEUE_TEXTURES] = { 0 };
+    for (size_t i = 0; i < _items.size(); ++i) {
+        RenderPacket& p = _packets[_items[i].index];
+        if (*p.program != program) {
+            program = *p.program;
+            p.program->Bind();
+        }
+        if (*p.vao != vao) {
+            vao = *p.vao;
+            p.vao->Bind();
+        }
+        for (unsigned t = 0; t < GLFK_RENDER_QUEUE_TEXTURES; ++t) {
+            if (p.textures[t] && *p.textures[t] != textures[t]) {
+                textures[t] = *p.textures[t];
+                p.textures[t]->SetTextureUnit(t);
+            }
+        }
+        Renderer::DrawElements(p.mode, p.count, p.type, p.indices);
+    }
+    
+#ifdef GLFK_ENSURE_UNBIND
+    VertexArray::BindNone();
+    Program::BindNone();
+#endif
+    _packets.clear();
+    return *this;
+}
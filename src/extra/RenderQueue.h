@@ -0,0 +1,93 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "core/VertexArray.h"
+#include "core/Shader.h"
+#include "core/Texture.h"
+
+#include <stdint.h>
+#include <vector>
+
+class Model;
+
+/// Number of texture units set by each RenderPacket
+#ifndef GLFK_RENDER_QUEUE_TEXTURES
+# define GLFK_RENDER_QUEUE_TEXTURES 4
+#endif
+
+/// Single indexed draw with the state it needs, objects must stay alive until RenderQueue::Submit
+struct RenderPacket {
+    RenderPacket();
+    
+    Program* program;
+    VertexArray* vao;
+    /// Textures bound to units 0..GLFK_RENDER_QUEUE_TEXTURES-1, NULL if unused
+    Texture* textures[GLFK_RENDER_QUEUE_TEXTURES];
+    DrawMode::E mode;
+    GLsizei count;
+    IndicesType::E type;
+    const GLvoid* indices;
+    /// View depth normalized to [0,1], lower depth is drawn first within the same state (use 1-depth for back to front)
+    float depth;
+    /// Layers are drawn in increasing order, e.g. opaque, sky, translucent, overlay
+    unsigned char layer;
+};
+
+/// Number of state changes done when drawing packets in some order
+struct RenderQueueStats {
+    RenderQueueStats() : programSwitches(0), vaoSwitches(0), textureSwitches(0) {};
+    
+    unsigned programSwitches;
+    unsigned vaoSwitches;
+    unsigned textureSwitches;
+};
+
+/** Queue of draws sorted to minimize state changes
+
+Each packet gets a 64-bit key made of (from the most significant bits) layer, program, textures, VAO and depth.
+Submit() radix sorts the keys and changes only the state differing from the previous packet.
+Object names are folded into the key bits, so collisions only affect grouping, never correctness.
+*/
+class RenderQueue
+{
+public:
+    RenderQueue();
+    
+    /// Add a packet, returns it so that textures or draw mode can be set
+    RenderPacket& Add(Program& program, VertexArray& vao, GLsizei count, IndicesType::E type, float depth,
+                      unsigned char layer = 0);
+    /// Add the draw of a model
+    RenderPacket& Add(Model& model, float depth, unsigned char layer = 0);
+    RenderQueue& Add(const RenderPacket& packet);
+    
+    /// Sort and draw all packets, then clear the queue
+    RenderQueue& Submit();
+    /// Remove all packets without drawing them
+    RenderQueue& Clear();
+    
+    unsigned GetPacketCount()const{ return _packets.size(); };
+    /// State changes the last Submit would do when drawing in the order of Add calls
+    const RenderQueueStats& GetUnsortedStats()const{ return _unsorted; };
+    /// State changes the last Submit did
+    const RenderQueueStats& GetSortedStats()const{ return _sorted; };
+    
+private:
+    struct SortItem {
+        uint64_t key;
+        unsigned index;
+    };
+    
+    static uint64_t MakeKey(const RenderPacket& packet);
+    /// Count state changes when drawing packets in order of _items
+    void CountSwitches(RenderQueueStats& stats, bool sorted)const;
+    void Sort();
+    
+    std::vector<RenderPacket> _packets;
+    std::vector<SortItem> _items;
+    std::vector<SortItem> _temp;
+    RenderQueueStats _unsorted;
+    RenderQueueStats _sorted;
+};
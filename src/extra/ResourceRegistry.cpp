@@ -0,0 +1,161 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+
+#include "ResourceRegistry.h"
+
+#include <stdio.h>
+
+ResourceRegistry::ResourceRegistry()
+{
+}
+
+ResourceRegistry::~ResourceRegistry()
+{
+    DestroyAll();
+    FlushDeletes();
+}
+
+ResourceRegistry& ResourceRegistry::CreateBuffers(GLenum target, unsigned count, BufferHandle* handles)
+{
+    if (count == 0) {
+        return *this;
+    }
+    std::vector<GLuint> names(count);
+    if (Renderer::HasDirectStateAccess()) {
+        glCreateBuffers(count, &names[0]);
+    } else {
+        glGenBuffers(count, &names[0]);
+    }
+    
+    BufferInfo info = { target, 0, BufferUsage::STATIC_DRAW };
+    for (unsigned i=0; i<count; i++) {
+        handles[i] = _buffers.Add(names[i], info);
+    }
+    return *this;
+}
+
+BufferHandle ResourceRegistry::CreateBuffer(GLenum target)
+{
+    BufferHandle handle;
+    CreateBuffers(target, 1, &handle);
+    return handle;
+}
+
+BufferHandle ResourceRegistry::AdoptBuffer(Buffer& buffer)
+{
+    if (buffer.RefCount() != 1) {
+        printf("%s: the buffer has other copies, not adopted!\n", __FUNCTION__);
+        return BufferHandle();
+    }
+    BufferInfo info = { buffer.GetTarget(), buffer.GetSize(), buffer.GetUsage() };
+    return _buffers.Add(buffer.Detach(), info);
+}
+
+ResourceRegistry& ResourceRegistry::CreateTextures(GLenum target, unsigned count, TextureHandle* handles)
+{
+    if (count == 0) {
+        return *this;
+    }
+    std::vector<GLuint> names(count);
+    if (Renderer::HasDirectStateAccess()) {
+        glCreateTextures(target, count, &names[0]);
+    } else {
+        glGenTextures(count, &names[0]);
+    }
+    
+    TextureInfo info = { target, 0, 0, 0, 0 };
+    for (unsigned i=0; i<count; i++) {
+        handles[i] = _textures.Add(names[i], info);
+    }
+    return *this;
+}
+
+TextureHandle ResourceRegistry::CreateTexture(GLenum target)
+{
+    TextureHandle handle;
+    CreateTextures(target, 1, &handle);
+    return handle;
+}
+
+TextureHandle ResourceRegistry::AdoptTexture(Texture& texture, GLenum format, GLsizei width, GLsizei height,
+                                             GLsizei depth)
+{
+    if (texture.RefCount() != 1) {
+        printf("%s: the texture has other copies, not adopted!\n", __FUNCTION__);
+        return TextureHandle();
+    }
+    TextureInfo info = { texture.GetTarget(), format, width, height, depth };
+    return _textures.Add(texture.Detach(), info);
+}
+
+ProgramHandle ResourceRegistry::AdoptProgram(Program& program)
+{
+    if (program.RefCount() != 1) {
+        printf("%s: the program has other copies, not adopted!\n", __FUNCTION__);
+        return ProgramHandle();
+    }
+    ProgramInfo info = { program.IsValid() };
+    return _programs.Add(program.Detach(), info);
+}
+
+ResourceRegistry& ResourceRegistry::Destroy(BufferHandle handle)
+{
+    GLuint name = _buffers.Remove(handle);
+    if (name) {
+        _deadBuffers.push_back(name);
+    }
+    return *this;
+}
+
+ResourceRegistry& ResourceRegistry::Destroy(TextureHandle handle)
+{
+    GLuint name = _textures.Remove(handle);
+    if (name) {
+        _deadTextures.push_back(name);
+    }
+    return *this;
+}
+
+ResourceRegistry& ResourceRegistry::Destroy(ProgramHandle handle)
+{
+    GLuint name = _programs.Remove(handle);
+    if (name) {
+        _deadPrograms.push_back(name);
+    }
+    return *this;
+}
+
+ResourceRegistry& ResourceRegistry::DestroyAll()
+{
+    _buffers.RemoveAll(_deadBuffers);
+    _textures.RemoveAll(_deadTextures);
+    _programs.RemoveAll(_deadPrograms);
+    return *this;
+}
+
+ResourceRegistry& ResourceRegistry::FlushDeletes()
+{
+#ifdef GLFK_PREVENT_MULTIPLE_BIND
+    // forgetting names one by one scans the whole cache for each, rebinding after a batch is cheaper
+    if (!_deadBuffers.empty() || !_deadTextures.empty() || !_deadPrograms.empty()) {
+        GLStateCache::Current().Invalidate();
+    }
+#endif
+    
+    if (!_deadBuffers.empty()) {
+        glDeleteBuffers(_deadBuffers.size(), &_deadBuffers[0]);
+        _deadBuffers.clear();
+    }
+    if (!_deadTextures.empty()) {
+        glDeleteTextures(_deadTextures.size(), &_deadTextures[0]);
+        _deadTextures.clear();
+    }
+    // programs have no batched delete
+    for (unsigned i=0; i<_deadPrograms.size(); i++) {
+        glDeleteProgram(_deadPrograms[i]);
+    }
+    _deadPrograms.clear();
+    return *this;
+}
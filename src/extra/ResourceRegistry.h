@@ -0,0 +1,240 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "core/Buffer.h"
+#include "core/Texture.h"
+#include "core/Shader.h"
+
+#include <vector>
+#include <stdint.h>
+
+/// Bits of a resource handle used for the slot index, the rest holds the generation of the slot
+#ifndef GLFK_HANDLE_INDEX_BITS
+# define GLFK_HANDLE_INDEX_BITS 20
+#endif
+
+/** 32-bit generational handle of a resource of a ResourceRegistry
+
+The generation changes whenever the slot is reused, so a handle of a destroyed resource is detected as stale.
+Zero is the null handle. Type distinguishes handles of different resources at compile time.
+*/
+template <int Type>
+struct ResourceHandle {
+    enum {
+        INDEX_BITS = GLFK_HANDLE_INDEX_BITS,
+        INDEX_MASK = (1u << INDEX_BITS) - 1,
+        GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1
+    };
+    
+    ResourceHandle() : value(0) {};
+    ResourceHandle(uint32_t index, uint32_t generation) : value(index | (generation << INDEX_BITS)) {};
+    
+    uint32_t GetIndex()const{ return value & INDEX_MASK; };
+    uint32_t GetGeneration()const{ return value >> INDEX_BITS; };
+    bool IsNull()const{ return value == 0; };
+    
+    bool operator==(const ResourceHandle& other)const{ return value == other.value; };
+    bool operator!=(const ResourceHandle& other)const{ return value != other.value; };
+    
+    uint32_t value;
+};
+
+typedef ResourceHandle<0> BufferHandle;
+typedef ResourceHandle<1> TextureHandle;
+typedef ResourceHandle<2> ProgramHandle;
+
+/** Dense storage of GL names and metadata of one resource type, addressed by generational handles
+
+Names and infos are kept in packed arrays suitable for iteration, destroying swaps the last element
+into the hole. Slots map handles to the dense arrays.
+*/
+template <typename Handle, typename Info>
+class ResourcePool
+{
+public:
+    Handle Add(GLuint name, const Info& info)
+    {
+        uint32_t index;
+        if (_freeSlots.empty()) {
+            index = _slots.size();
+            assert(index <= Handle::INDEX_MASK); // too many resources, increase GLFK_HANDLE_INDEX_BITS
+            Slot slot = { 0, 1 };
+            _slots.push_back(slot);
+        } else {
+            index = _freeSlots.back();
+            _freeSlots.pop_back();
+        }
+        
+        _slots[index].dense = _names.size();
+        _names.push_back(name);
+        _infos.push_back(info);
+        _denseToSlot.push_back(index);
+        return Handle(index, _slots[index].generation);
+    }
+    
+    /// Returns position in the dense arrays or -1 for a stale or null handle
+    int Find(Handle handle)const
+    {
+        uint32_t index = handle.GetIndex();
+        if (handle.IsNull() || index >= _slots.size() || _slots[index].generation != handle.GetGeneration()) {
+            return -1;
+        }
+        return _slots[index].dense;
+    }
+    
+    /// Removes the resource and returns its name, 0 for a stale handle
+    GLuint Remove(Handle handle)
+    {
+        int dense = Find(handle);
+        if (dense < 0) {
+            return 0;
+        }
+        GLuint name = _names[dense];
+        
+        // move the last element into the hole
+        uint32_t last = _names.size() - 1;
+        _names[dense] = _names[last];
+        _infos[dense] = _infos[last];
+        _denseToSlot[dense] = _denseToSlot[last];
+        _slots[_denseToSlot[dense]].dense = dense;
+        _names.pop_back();
+        _infos.pop_back();
+        _denseToSlot.pop_back();
+        
+        Slot& slot = _slots[handle.GetIndex()];
+        slot.generation = (slot.generation + 1) & Handle::GENERATION_MASK;
+        if (slot.generation == 0) {
+            slot.generation = 1; // keep handles non-null
+        }
+        _freeSlots.push_back(handle.GetIndex());
+        return name;
+    }
+    
+    /// Removes all resources, appending their names to the list
+    void RemoveAll(std::vector<GLuint>& names)
+    {
+        names.insert(names.end(), _names.begin(), _names.end());
+        for (unsigned i=0; i<_denseToSlot.size(); i++) {
+            Slot& slot = _slots[_denseToSlot[i]];
+            slot.generation = (slot.generation + 1) & Handle::GENERATION_MASK;
+            if (slot.generation == 0) {
+                slot.generation = 1;
+            }
+            _freeSlots.push_back(_denseToSlot[i]);
+        }
+        _names.clear();
+        _infos.clear();
+        _denseToSlot.clear();
+    }
+    
+    unsigned GetCount()const{ return _names.size(); };
+    GLuint GetName(int dense)const{ return _names[dense]; };
+    Info& GetInfo(int dense){ return _infos[dense]; };
+    /// Packed arrays of GetCount() elements
+    const GLuint* GetNames()const{ return _names.empty() ? NULL : &_names[0]; };
+    Info* GetInfos(){ return _infos.empty() ? NULL : &_infos[0]; };
+    
+private:
+    struct Slot {
+        uint32_t dense;
+        uint32_t generation;
+    };
+    
+    std::vector<Slot> _slots;
+    std::vector<uint32_t> _freeSlots;
+    
+    std::vector<GLuint> _names;
+    std::vector<Info> _infos;
+    std::vector<uint32_t> _denseToSlot;
+};
+
+/** Owner of GL buffers, textures and programs referenced by generational handles
+
+An alternative to the reference counted wrappers for large numbers of resources, e.g. of a streamed level.
+Names are created and deleted in batches: Destroy() queues the name and FlushDeletes() issues one glDelete*
+per type. Existing Buffer, Texture and Program objects are handed over by Adopt*, the registry takes their
+GL names. Use GetName() to pass a resource to GL or to code working with names.
+The registry must be flushed or cleared while its context is current.
+*/
+class ResourceRegistry : public NoCopy
+{
+public:
+    struct BufferInfo {
+        GLenum target;
+        GLsizeiptr size;
+        BufferUsage::E usage;
+    };
+    struct TextureInfo {
+        GLenum target;
+        GLenum format; ///< internal format, 0 if not known
+        GLsizei width;
+        GLsizei height;
+        GLsizei depth;
+    };
+    struct ProgramInfo {
+        bool linked;
+    };
+    
+    ResourceRegistry();
+    /// Deletes all resources, the context must be current
+    ~ResourceRegistry();
+    
+    /// Create count buffers using a single glGenBuffers (glCreateBuffers with Direct State Access)
+    ResourceRegistry& CreateBuffers(GLenum target, unsigned count, BufferHandle* handles);
+    BufferHandle CreateBuffer(GLenum target);
+    /// Take over GL name of the buffer, which must be the only copy and is left empty.
+    /// Returns a null handle and leaves the object untouched if it has other copies.
+    BufferHandle AdoptBuffer(Buffer& buffer);
+    
+    /// Create count textures using a single glGenTextures (glCreateTextures with Direct State Access)
+    ResourceRegistry& CreateTextures(GLenum target, unsigned count, TextureHandle* handles);
+    TextureHandle CreateTexture(GLenum target);
+    /// Take over GL name of the texture, which must be the only copy and is left empty.
+    /// Returns a null handle and leaves the object untouched if it has other copies.
+    TextureHandle AdoptTexture(Texture& texture, GLenum format = 0, GLsizei width = 0, GLsizei height = 0,
+                               GLsizei depth = 0);
+    
+    /// Take over GL name of the program, which must be the only copy and is left empty.
+    /// Returns a null handle and leaves the object untouched if it has other copies.
+    ProgramHandle AdoptProgram(Program& program);
+    
+    /// Returns GL name of the resource, 0 for a stale or null handle
+    GLuint GetName(BufferHandle handle)const{ int i = _buffers.Find(handle); return i < 0 ? 0 : _buffers.GetName(i); };
+    GLuint GetName(TextureHandle handle)const{ int i = _textures.Find(handle); return i < 0 ? 0 : _textures.GetName(i); };
+    GLuint GetName(ProgramHandle handle)const{ int i = _programs.Find(handle); return i < 0 ? 0 : _programs.GetName(i); };
+    
+    /// Returns metadata of the resource, NULL for a stale or null handle
+    BufferInfo* GetInfo(BufferHandle handle){ int i = _buffers.Find(handle); return i < 0 ? NULL : &_buffers.GetInfo(i); };
+    TextureInfo* GetInfo(TextureHandle handle){ int i = _textures.Find(handle); return i < 0 ? NULL : &_textures.GetInfo(i); };
+    ProgramInfo* GetInfo(ProgramHandle handle){ int i = _programs.Find(handle); return i < 0 ? NULL : &_programs.GetInfo(i); };
+    
+    bool IsValid(BufferHandle handle)const{ return _buffers.Find(handle) >= 0; };
+    bool IsValid(TextureHandle handle)const{ return _textures.Find(handle) >= 0; };
+    bool IsValid(ProgramHandle handle)const{ return _programs.Find(handle) >= 0; };
+    
+    /// Queue the resource for deletion by FlushDeletes(), the handle becomes stale immediately
+    ResourceRegistry& Destroy(BufferHandle handle);
+    ResourceRegistry& Destroy(TextureHandle handle);
+    ResourceRegistry& Destroy(ProgramHandle handle);
+    /// Queue all resources for deletion
+    ResourceRegistry& DestroyAll();
+    /// Delete queued resources, one glDeleteBuffers and glDeleteTextures for all of them
+    ResourceRegistry& FlushDeletes();
+    
+    /// Dense arrays for iteration over all resources of a type
+    ResourcePool<BufferHandle, BufferInfo>& GetBuffers(){ return _buffers; };
+    ResourcePool<TextureHandle, TextureInfo>& GetTextures(){ return _textures; };
+    ResourcePool<ProgramHandle, ProgramInfo>& GetPrograms(){ return _programs; };
+    
+private:
+    ResourcePool<BufferHandle, BufferInfo> _buffers;
+    ResourcePool<TextureHandle, TextureInfo> _textures;
+    ResourcePool<ProgramHandle, ProgramInfo> _programs;
+    
+    std::vector<GLuint> _deadBuffers;
+    std::vector<GLuint> _deadTextures;
+    std::vector<GLuint> _deadPrograms;
+};
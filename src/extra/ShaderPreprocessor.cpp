@@ -0,0 +1,226 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+
+#include "ShaderPreprocessor.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+ShaderDefines& ShaderDefines::Set(const std::string& name, int value)
+{
+    char buf[16];
+    sprintf(buf, "%d", value);
+    return Set(name, buf);
+}
+
+std::string ShaderDefines::GetSource()const
+{
+    std::string out;
+    for (std::map<std::string, std::string>::const_iterator it = _defines.begin(); it != _defines.end(); ++it) {
+        out += "#define " + it->first + " " + it->second + "\n";
+    }
+    return out;
+}
+
+uint64_t ShaderDefines::GetHash(uint64_t seed)const
+{
+    for (std::map<std::string, std::string>::const_iterator it = _defines.begin(); it != _defines.end(); ++it) {
+        seed = Hash64(it->first.c_str(), it->first.size() + 1, seed);
+        seed = Hash64(it->second.c_str(), it->second.size() + 1, seed);
+    }
+    return seed;
+}
+
+//-----------------------------------------------------
+
+static bool FileExists(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+static std::string DirName(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+/// Returns the directive name if the line is a preprocessor directive, rest points after the name
+static std::string GetDirective(const std::string& line, size_t& rest)
+{
+    size_t i = line.find_first_not_of(" \t");
+    if (i == std::string::npos || line[i] != '#') {
+        return std::string();
+    }
+    i = line.find_first_not_of(" \t", i + 1);
+    if (i == std::string::npos) {
+        return std::string();
+    }
+    size_t end = line.find_first_of(" \t\r", i);
+    rest = end == std::string::npos ? line.size() : end;
+    return line.substr(i, rest - i);
+}
+
+static std::string LineDirective(unsigned line, unsigned file)
+{
+    char buf[48];
+    sprintf(buf, "#line %u %u\n", line, file);
+    return buf;
+}
+
+ShaderPreprocessor& ShaderPreprocessor::AddIncludePath(const std::string& dir)
+{
+    if (!dir.empty() && dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\') {
+        _includePaths.push_back(dir + "/");
+    } else {
+        _includePaths.push_back(dir);
+    }
+    return *this;
+}
+
+std::string ShaderPreprocessor::ProcessFile(const char* path, const ShaderDefines& defines)
+{
+    if (!FileExists(path)) {
+        printf("%s: file %s not found\n", __FUNCTION__, path);
+        _files.clear();
+        return std::string();
+    }
+    return ProcessSource(ReadFile(path), path, defines);
+}
+
+std::string ShaderPreprocessor::ProcessSource(const std::string& source, const char* name,
+                                              const ShaderDefines& defines)
+{
+    _files.clear();
+    _files.push_back(name);
+    _versionSeen = false;
+    
+    std::string out;
+    out.reserve(source.size() + 256);
+    if (!Process(source, 0, defines, out)) {
+        return std::string();
+    }
+    if (!_versionSeen && !defines.IsEmpty()) {
+        out = defines.GetSource() + LineDirective(1, 0) + out;
+    }
+    return out;
+}
+
+std::string ShaderPreprocessor::ResolveInclude(const std::string& name, unsigned from)const
+{
+    std::string path = DirName(_files[from]) + name;
+    if (FileExists(path)) {
+        return path;
+    }
+    for (size_t i = 0; i < _includePaths.size(); ++i) {
+        path = _includePaths[i] + name;
+        if (FileExists(path)) {
+            return path;
+        }
+    }
+    return std::string();
+}
+
+bool ShaderPreprocessor::Process(const std::string& source, unsigned file, const ShaderDefines& defines,
+                                 std::string& out)
+{
+    unsigned lineNum = 0;
+    size_t pos = 0;
+    while (pos < source.size()) {
+        size_t eol = source.find('\n', pos);
+        if (eol == std::string::npos) {
+            eol = source.size();
+        }
+        std::string line = source.substr(pos, eol - pos);
+        pos = eol + 1;
+        ++lineNum;
+        
+        if (!line.empty() && line[line.size() - 1] == '\0') {
+            line.erase(line.size() - 1); // ReadFile appends the terminating zero
+        }
+        
+        size_t rest = 0;
+        std::string directive = GetDirective(line, rest);
+        
+        if (directive == "version" && file == 0 && !_versionSeen) {
+            _versionSeen = true;
+            out += line + "\n";
+            if (!defines.IsEmpty()) {
+                out += defines.GetSource() + LineDirective(lineNum + 1, file);
+            }
+        } else if (directive == "pragma" && line.find("once", rest) != std::string::npos) {
+            out += "\n";
+        } else if (directive == "include") {
+            size_t open = line.find_first_of("\"<", rest);
+            size_t close = open == std::string::npos ? open : line.find_first_of("\">", open + 1);
+            if (close == std::string::npos) {
+                printf("%s:%u: malformed #include\n", _files[file].c_str(), lineNum);
+                return false;
+            }
+            std::string name = line.substr(open + 1, close - open - 1);
+            std::string path = ResolveInclude(name, file);
+            if (path.empty()) {
+                printf("%s:%u: included file %s not found\n", _files[file].c_str(), lineNum, name.c_str());
+                return false;
+            }
+            
+            bool included = false;
+            for (size_t i = 0; i < _files.size() && !included; ++i) {
+                included = _files[i] == path;
+            }
+            if (included) {
+                out += "\n";
+                continue;
+            }
+            
+            unsigned index = _files.size();
+            _files.push_back(path);
+            out += LineDirective(1, index);
+            if (!Process(ReadFile(path.c_str()), index, defines, out)) {
+                return false;
+            }
+            out += LineDirective(lineNum + 1, file);
+        } else {
+            out += line + "\n";
+        }
+    }
+    return true;
+}
+
+std::string ShaderPreprocessor::FormatLog(const std::string& log)const
+{
+    std::string out;
+    size_t pos = 0;
+    while (pos < log.size()) {
+        size_t eol = log.find('\n', pos);
+        if (eol == std::string::npos) {
+            eol = log.size() - 1;
+        }
+        std::string line = log.substr(pos, eol + 1 - pos);
+        pos = eol + 1;
+        
+        // skip "ERROR: " or similar prefix
+        size_t start = 0;
+        size_t colon = line.find(": ");
+        if (colon != std::string::npos && colon < 10 && !isdigit((unsigned char)line[0])) {
+            start = colon + 2;
+        }
+        size_t end = start;
+        while (end < line.size() && isdigit((unsigned char)line[end])) {
+            ++end;
+        }
+        if (end > start && end < line.size() && (line[end] == '(' || line[end] == ':')) {
+            unsigned file = atoi(line.substr(start, end - start).c_str());
+            if (file < _files.size()) {
+                line = line.substr(0, start) + _files[file] + line.substr(end);
+            }
+        }
+        out += line;
+    }
+    return out;
+}
@@ -0,0 +1,63 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "core/Utils.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/// Set of #define NAME VALUE lines injected into a shader variant, ordered by name so equal sets hash equally
+class ShaderDefines
+{
+public:
+    ShaderDefines& Set(const std::string& name, const std::string& value = "1"){ _defines[name] = value; return *this; };
+    ShaderDefines& Set(const std::string& name, int value);
+    ShaderDefines& Remove(const std::string& name){ _defines.erase(name); return *this; };
+    
+    bool IsEmpty()const{ return _defines.empty(); };
+    /// Returns the #define lines
+    std::string GetSource()const;
+    uint64_t GetHash(uint64_t seed = 14695981039346656037ull)const;
+    
+private:
+    std::map<std::string, std::string> _defines;
+};
+
+/** Front end of GLSL sources resolving #include and injecting defines
+
+Each file is included once at most (as if it had an include guard, #pragma once lines are dropped).
+Defines are inserted after #version. #line directives keep line numbers of every file, using the index
+of the file in GetFiles() as the source string number, see FormatLog().
+*/
+class ShaderPreprocessor
+{
+public:
+    ShaderPreprocessor(){};
+    
+    /// Add directory searched for included files after the directory of the including file
+    ShaderPreprocessor& AddIncludePath(const std::string& dir);
+    
+    /// Returns preprocessed source of the file, empty string if the file or any included file was not found
+    std::string ProcessFile(const char* path, const ShaderDefines& defines = ShaderDefines());
+    /// Returns preprocessed source, name is used as the file name of the source in GetFiles()
+    std::string ProcessSource(const std::string& source, const char* name,
+                              const ShaderDefines& defines = ShaderDefines());
+    
+    /// Files used by the last Process*, index is the source string number in #line directives
+    const std::vector<std::string>& GetFiles()const{ return _files; };
+    
+    /// Replace source string numbers at the beginning of info log lines, "0(12)" or "0:12", with file names
+    std::string FormatLog(const std::string& log)const;
+    
+private:
+    bool Process(const std::string& source, unsigned file, const ShaderDefines& defines, std::string& out);
+    std::string ResolveInclude(const std::string& name, unsigned from)const;
+    
+    std::vector<std::string> _includePaths;
+    std::vector<std::string> _files;
+    bool _versionSeen;
+};
@@ -0,0 +1,216 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+
+#include "ShaderWatcher.h"
+
+#include <stdio.h>
+
+#ifdef __linux__
+# include <sys/inotify.h>
+# include <unistd.h>
+# include <errno.h>
+#endif
+
+/// Returns directory of the path including the trailing slash, "./" for bare file names
+static std::string WatchedDir(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? std::string("./") : path.substr(0, slash + 1);
+}
+
+/// Returns path without leading "./" so that paths from events compare equal to the added ones
+static std::string NormalizePath(const std::string& path)
+{
+    return path.compare(0, 2, "./") == 0 ? path.substr(2) : path;
+}
+
+ShaderWatcher::ShaderWatcher()
+: _fd(-1), _reloads(0), _failures(0)
+{
+#ifdef __linux__
+    _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_fd < 0) {
+        printf("%s: inotify unavailable, only Reload() will reload programs\n", __FUNCTION__);
+    }
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+    if (_fd >= 0) {
+        close(_fd);
+    }
+#endif
+}
+
+bool ShaderWatcher::IsSupported()
+{
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+unsigned ShaderWatcher::Add(const char* vertexPath, const char* fragmentPath, const AttribBinding* bindings,
+                            const ShaderDefines& defines)
+{
+    _entries.push_back(Entry());
+    Entry& entry = _entries.back();
+    entry.vertexPath = vertexPath;
+    entry.fragmentPath = fragmentPath;
+    entry.defines = defines;
+    for (const AttribBinding* b = bindings; b && b->name; ++b) {
+        entry.bindingIndices.push_back(b->index);
+        entry.bindingNames.push_back(b->name);
+    }
+    
+    if (StartLink(entry, entry.current) && !entry.current.FinishLink()) {
+        std::string log = entry.current.GetInfoLog();
+        printf("%s: %s + %s failed to link: %s\n", __FUNCTION__, vertexPath, fragmentPath, log.c_str());
+    }
+    WatchFiles(entry.files);
+    return _entries.size() - 1;
+}
+
+bool ShaderWatcher::StartLink(Entry& entry, Program& program)
+{
+    std::vector<std::string> files;
+    
+    std::string vs = _preprocessor.ProcessFile(entry.vertexPath.c_str(), entry.defines);
+    files = _preprocessor.GetFiles();
+    std::string fs = _preprocessor.ProcessFile(entry.fragmentPath.c_str(), entry.defines);
+    files.insert(files.end(), _preprocessor.GetFiles().begin(), _preprocessor.GetFiles().end());
+    for (size_t i = 0; i < files.size(); ++i) {
+        files[i] = NormalizePath(files[i]);
+    }
+    entry.files.swap(files);
+    
+    if (vs.empty() || fs.empty()) {
+        return false;
+    }
+    
+    // shaders are compiled by LinkAsync, together with the link
+    VertexShader vertex(vs);
+    FragmentShader fragment(fs);
+    program = Program(vertex, fragment);
+    for (size_t i = 0; i < entry.bindingIndices.size(); ++i) {
+        program.BindAttribLocation(entry.bindingIndices[i], entry.bindingNames[i].c_str());
+    }
+    program.LinkAsync();
+    return true;
+}
+
+void ShaderWatcher::WatchFiles(const std::vector<std::string>& files)
+{
+#ifdef __linux__
+    if (_fd < 0) {
+        return;
+    }
+    // editors often replace files instead of writing them, so directories are watched rather than files
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::string dir = WatchedDir(files[i]);
+        int wd = inotify_add_watch(_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd < 0) {
+            printf("%s: unable to watch %s\n", __FUNCTION__, dir.c_str());
+        } else {
+            _watches[wd] = dir; // same directory gets the same descriptor
+        }
+    }
+#endif
+}
+
+void ShaderWatcher::ReadEvents()
+{
+#ifdef __linux__
+    if (_fd < 0) {
+        return;
+    }
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t len = read(_fd, buf, sizeof(buf));
+        if (len <= 0) {
+            break; // EAGAIN, nothing more to read
+        }
+        for (char* ptr = buf; ptr < buf + len; ) {
+            const struct inotify_event* event = (const struct inotify_event*)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+            
+            std::map<int, std::string>::iterator it = _watches.find(event->wd);
+            if (it == _watches.end() || event->len == 0) {
+                continue;
+            }
+            std::string path = NormalizePath(it->second + event->name);
+            for (size_t e = 0; e < _entries.size(); ++e) {
+                const std::vector<std::string>& files = _entries[e].files;
+                for (size_t f = 0; f < files.size(); ++f) {
+                    if (files[f] == path) {
+                        _entries[e].dirty = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+#endif
+}
+
+ShaderWatcher& ShaderWatcher::Reload(unsigned id)
+{
+    _entries[id].dirty = true;
+    return *this;
+}
+
+void ShaderWatcher::FinishReload(Entry& entry)
+{
+    entry.reloading = false;
+    if (entry.pending.FinishLink()) {
+        entry.current = entry.pending; // swap only a working program
+        ++_reloads;
+        printf("Reloaded %s + %s\n", entry.vertexPath.c_str(), entry.fragmentPath.c_str());
+    } else {
+        std::string log = entry.pending.GetInfoLog();
+        printf("Reload of %s + %s failed, keeping the previous program: %s\n",
+               entry.vertexPath.c_str(), entry.fragmentPath.c_str(), log.c_str());
+        ++_failures;
+    }
+    entry.pending = Program();
+    // new includes may have appeared
+    WatchFiles(entry.files);
+}
+
+unsigned ShaderWatcher::Update(unsigned maxBlocking)
+{
+    ReadEvents();
+    
+    bool parallel = Renderer::HasParallelShaderCompile();
+    unsigned reloading = 0;
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        Entry& entry = _entries[i];
+        
+        if (entry.reloading) {
+            if (parallel ? entry.pending.IsReady() : maxBlocking > 0) {
+                if (!parallel) {
+                    --maxBlocking;
+                }
+                FinishReload(entry);
+            }
+        }
+        // a file changed during the reload starts another one after it finishes
+        if (entry.dirty && !entry.reloading) {
+            entry.dirty = false;
+            if (StartLink(entry, entry.pending)) {
+                entry.reloading = true;
+            } else {
+                ++_failures;
+            }
+        }
+        if (entry.reloading) {
+            ++reloading;
+        }
+    }
+    return reloading;
+}
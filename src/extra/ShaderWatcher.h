@@ -0,0 +1,81 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "core/Shader.h"
+#include "Shaders.h"
+#include "ShaderPreprocessor.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/** Opt-in hot reload of programs built from shader files
+
+Directories of the shader files and their includes are watched with inotify (Linux only, see IsSupported).
+Update() called once per frame relinks the changed programs using LinkAsync, finishing them when the driver
+reports completion (parallel shader compile) or a limited number per frame otherwise. The reloaded program
+replaces the current one only when it links, so a broken edit keeps the last working program.
+Always use GetProgram() when drawing, as the program object changes with every reload.
+*/
+class ShaderWatcher : public NoCopy
+{
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+    
+    /// Returns true if file changes are detected automatically on this platform
+    static bool IsSupported();
+    
+    /// Watch program of the vertex and fragment shader files, links it immediately. Returns id of the program.
+    unsigned Add(const char* vertexPath, const char* fragmentPath, const AttribBinding* bindings = NULL,
+                 const ShaderDefines& defines = ShaderDefines());
+    /// Returns the last successfully linked program
+    Program& GetProgram(unsigned id){ return _entries[id].current; };
+    /// Preprocessor used for the files, add include paths here
+    ShaderPreprocessor& GetPreprocessor(){ return _preprocessor; };
+    
+    /// Reload the program even if no file changed
+    ShaderWatcher& Reload(unsigned id);
+    /// Process file changes and finish pending reloads, blocking on at most maxBlocking links without
+    /// parallel shader compile. Returns number of reloads in progress.
+    unsigned Update(unsigned maxBlocking = 1);
+    
+    unsigned GetReloadCount()const{ return _reloads; };
+    unsigned GetFailedCount()const{ return _failures; };
+    
+private:
+    struct Entry {
+        Entry() : dirty(false), reloading(false) {};
+        
+        std::string vertexPath;
+        std::string fragmentPath;
+        std::vector<unsigned> bindingIndices;
+        std::vector<std::string> bindingNames;
+        ShaderDefines defines;
+        /// Files the program was built from, including included files
+        std::vector<std::string> files;
+        
+        Program current;
+        Program pending;
+        bool dirty;
+        bool reloading;
+    };
+    
+    /// Build program of the entry and start linking it, false if a file couldn't be read
+    bool StartLink(Entry& entry, Program& program);
+    void FinishReload(Entry& entry);
+    void WatchFiles(const std::vector<std::string>& files);
+    /// Read pending change notifications without blocking and mark affected entries dirty
+    void ReadEvents();
+    
+    std::vector<Entry> _entries;
+    ShaderPreprocessor _preprocessor;
+    int _fd;
+    /// watch descriptor -> watched directory
+    std::map<int, std::string> _watches;
+    unsigned _reloads;
+    unsigned _failures;
+};
@@ -5,20 +5,98 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 
 #include "Shaders.h"
 #include <stdio.h>
+#include <string.h>
 
-#define STATIC_OBJ(type, name) static type* name = NULL;    \
-    if (name == NULL) {                                     \
-        name = new type();                                  \
+ShaderRegistry::RegistryMap ShaderRegistry::s_registries;
+
+ShaderRegistry::ShaderRegistry()
+: _compiles(0), _links(0)
+{
+}
+
+ShaderRegistry::~ShaderRegistry()
+{
+    _programs.clear();
+    for (ShaderMap::iterator it = _shaders.begin(); it != _shaders.end(); ++it) {
+        it->second.del(it->second.shader);
+    }
+    for (PermutationMap::iterator it = _permutations.begin(); it != _permutations.end(); ++it) {
+        it->second.del(it->second.shader);
+    }
+    for (PermutationMap::iterator it = _failedPermutations.begin(); it != _failedPermutations.end(); ++it) {
+        it->second.del(it->second.shader);
+    }
+}
+
+ShaderRegistry& ShaderRegistry::Current()
+{
+    ShaderRegistry*& registry = s_registries[&GLStateCache::Current()];
+    if (!registry) {
+        registry = new ShaderRegistry;
+    }
+    return *registry;
+}
+
+void ShaderRegistry::Release(const GLStateCache* context)
+{
+    RegistryMap::iterator it = s_registries.find(context);
+    if (it != s_registries.end()) {
+        delete it->second;
+        s_registries.erase(it);
+    }
+}
+
+void ShaderRegistry::Compile(BaseShader& sh, const char* key)
+{
+    ++_compiles;
+    if (!sh.Compile()) {
+        std::string log = sh.GetInfoLog();
+        printf("%s failed to compile: %s\n", key, log.c_str());
+    }
+}
+
+void ShaderRegistry::CompilePermutation(BaseShader& sh, const char* name)
+{
+    ++_compiles;
+    if (!sh.Compile()) {
+        // report file names instead of source string numbers of #line directives
+        std::string log = _preprocessor.FormatLog(sh.GetInfoLog());
+        printf("%s failed to compile:\n%s\n", name, log.c_str());
+    }
+}
+
+Program& ShaderRegistry::GetProgram(BaseShader& sh1, BaseShader& sh2, const AttribBinding* bindings)
+{
+    // shader names are unique in the context while the shaders are alive
+    GLuint names[2] = { sh1, sh2 };
+    uint64_t key = Hash64(names, sizeof(names));
+    for (const AttribBinding* b = bindings; b && b->name; ++b) {
+        key = Hash64(&b->index, sizeof(b->index), key);
+        key = Hash64(b->name, strlen(b->name) + 1, key);
+    }
+    
+    ProgramMap::iterator it = _programs.find(key);
+    if (it != _programs.end()) {
+        return it->second;
     }
+    
+    Program& prg = _programs.insert(std::make_pair(key, Program(sh1, sh2))).first->second;
+    for (const AttribBinding* b = bindings; b && b->name; ++b) {
+        prg.BindAttribLocation(b->index, b->name);
+    }
+    ++_links;
+    if (!prg.Link()) {
+        std::string log = prg.GetInfoLog();
+        printf("%s: link failed: %s\n", __FUNCTION__, log.c_str());
+    }
+    return prg;
+}
+
+//-----------------------------------------------------
 
+/// Returns the built-in shader, registered under the name of the calling function
 #define STATIC_SHADER(type, source) {                                       \
-    STATIC_OBJ(type, obj);                                                  \
-    obj->SetSource(source);                                                 \
-    if (!obj->Compile()) {                                                  \
-        std::string log = obj->GetInfoLog();                                \
-        printf("%s failed to compile: %s\n", __FUNCTION__, log.c_str());    \
-    }                                                                       \
-    return *obj;                                                            \
+    return ShaderRegistry::Current().GetShader<type>(__FUNCTION__, source); \
 }
 
 VertexShader& VertexShaders::NoTransform()
@@ -5,6 +5,130 @@ GLFK LICENSE (BSD-based) - please see LICENSE.md
 #pragma once
 
 #include "core/Shader.h"
+#include "ShaderPreprocessor.h"
+
+#include <map>
+#include <string>
+#include <string.h>
+
+/// Attribute binding used when linking registry programs, arrays are terminated by { 0, NULL }
+struct AttribBinding {
+    GLuint index;
+    const char* name;
+};
+
+/** Shaders and linked programs of one GL context, each compiled or linked only once
+
+Built-in shaders of VertexShaders/FragmentShaders are kept here, so they compile on first use only.
+Programs are shared by all users of the same shaders and attribute bindings.
+*/
+class ShaderRegistry : public NoCopy
+{
+public:
+    /// Returns registry of the current context (identified by its GLStateCache)
+    static ShaderRegistry& Current();
+    /// Delete registry of the context, its context must be current. extra/Window calls it when destroyed.
+    static void Release(const GLStateCache* context);
+    
+    /// Returns the shader registered under the key, compiling it from the source on first use
+    template <typename T>
+    T& GetShader(const char* key, const char* source) {
+        ShaderMap::iterator it = _shaders.find(key);
+        if (it != _shaders.end()) {
+            return *(T*)it->second.shader;
+        }
+        T* sh = new T(source);
+        ShaderEntry entry = { sh, &DeleteShader<T> };
+        _shaders[key] = entry;
+        Compile(*sh, key);
+        return *sh;
+    }
+    
+    /** Returns permutation of the shader file with the defines, compiled on first use only.
+    Permutations are keyed by hash of the preprocessed source and the defines, so edits of the file or of its
+    includes give a new permutation. The file is preprocessed on every call, keep the shader rather than asking
+    for it every frame. If preprocessing fails, a shader without source is returned and the next call retries. */
+    template <typename T>
+    T& GetShaderFile(const char* path, const ShaderDefines& defines = ShaderDefines()) {
+        return GetPermutation<T>(path, NULL, defines);
+    }
+    /// Returns permutation of the source with the defines, keyed like GetShaderFile()
+    template <typename T>
+    T& GetShaderSource(const std::string& source, const ShaderDefines& defines = ShaderDefines(),
+                       const char* name = "source") {
+        return GetPermutation<T>(name, &source, defines);
+    }
+    /// Preprocessor used for permutations, add include paths here
+    ShaderPreprocessor& GetPreprocessor(){ return _preprocessor; };
+    
+    /// Returns program linked from the shaders with the attribute bindings, linking it on first use
+    Program& GetProgram(BaseShader& sh1, BaseShader& sh2, const AttribBinding* bindings = NULL);
+    
+    unsigned GetCompileCount()const{ return _compiles; };
+    unsigned GetLinkCount()const{ return _links; };
+    
+private:
+    ShaderRegistry();
+    ~ShaderRegistry();
+    
+    template <typename T>
+    static void DeleteShader(BaseShader* sh) { delete (T*)sh; }
+    void Compile(BaseShader& sh, const char* key);
+    
+    template <typename T>
+    T& GetPermutation(const char* name, const std::string* source, const ShaderDefines& defines) {
+        std::string processed = source ? _preprocessor.ProcessSource(*source, name, defines)
+                                       : _preprocessor.ProcessFile(name, defines);
+        if (processed.empty()) {
+            // not cached as a permutation, the next request preprocesses again, e.g. after the file was fixed
+            return GetFailedPermutation<T>(defines.GetHash(Hash64(name, strlen(name) + 1)));
+        }
+        // the included files are part of the processed source
+        uint64_t key = defines.GetHash(Hash64(processed.c_str(), processed.size()));
+        PermutationMap::iterator it = _permutations.find(key);
+        if (it != _permutations.end()) {
+            return *(T*)it->second.shader;
+        }
+        T* sh = new T();
+        ShaderEntry entry = { sh, &DeleteShader<T> };
+        _permutations[key] = entry;
+        sh->SetSource(processed);
+        CompilePermutation(*sh, name);
+        return *sh;
+    }
+    /// Returns the shader without source standing in for permutations which failed to preprocess
+    template <typename T>
+    T& GetFailedPermutation(uint64_t key) {
+        PermutationMap::iterator it = _failedPermutations.find(key);
+        if (it != _failedPermutations.end()) {
+            return *(T*)it->second.shader;
+        }
+        T* sh = new T();
+        ShaderEntry entry = { sh, &DeleteShader<T> };
+        _failedPermutations[key] = entry;
+        return *sh;
+    }
+    void CompilePermutation(BaseShader& sh, const char* name);
+    
+    struct ShaderEntry {
+        BaseShader* shader;
+        void (*del)(BaseShader*);
+    };
+    typedef std::map<std::string, ShaderEntry> ShaderMap;
+    typedef std::map<uint64_t, ShaderEntry> PermutationMap;
+    typedef std::map<uint64_t, Program> ProgramMap;
+    typedef std::map<const GLStateCache*, ShaderRegistry*> RegistryMap;
+    
+    static RegistryMap s_registries;
+    
+    ShaderMap _shaders;
+    PermutationMap _permutations;
+    PermutationMap _failedPermutations;
+    ShaderPreprocessor _preprocessor;
+    ProgramMap _programs;
+    unsigned _compiles;
+    unsigned _links;
+};
 
 /// Library of common vertex shaders
 class VertexShaders
@@ -0,0 +1,127 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+
+#include "UniformBlock.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+UniformRing::UniformRing(unsigned size, unsigned regions)
+: _stream(NULL), _alignment(UniformBuffer::GetOffsetAlignment()), _head(0), _wraps(0)
+{
+    if (_alignment == 0) {
+        _alignment = 256; // maximum required by the spec
+    }
+    // regions start at multiples of the size, keep them aligned
+    _size = (size + _alignment - 1) / _alignment * _alignment;
+    if (Renderer::HasBufferStorage()) {
+        _stream = new StreamBuffer(VertexArray::None(), GL_UNIFORM_BUFFER, _size, regions);
+        return;
+    }
+    _buffer.SetData(_size, NULL, BufferUsage::STREAM_DRAW);
+}
+
+UniformRing::~UniformRing()
+{
+    delete _stream;
+}
+
+UniformRing& UniformRing::Push(GLuint binding, const void* data, unsigned size, unsigned bindSize)
+{
+    if (bindSize < size) {
+        bindSize = size;
+    }
+    assert(bindSize <= _size); // ring too small
+    
+    if (_stream) {
+        GLintptr offset;
+        void* slice = _stream->Allocate(bindSize, offset, _alignment);
+        if (!slice) {
+            // the region of this frame is full, continue in the next one once the GPU is done with it
+            _stream->NextFrame();
+            ++_wraps;
+            slice = _stream->Allocate(bindSize, offset, _alignment);
+        }
+        memcpy(slice, data, size);
+        _stream->BindRange(binding, offset, bindSize);
+        return *this;
+    }
+    
+    unsigned offset = (_head + _alignment - 1) / _alignment * _alignment;
+    if (offset + bindSize > _size) {
+        // orphan the storage, draws in flight keep reading the old one
+        _buffer.SetData(_size, NULL, BufferUsage::STREAM_DRAW);
+        offset = 0;
+        ++_wraps;
+    }
+    _head = offset + bindSize;
+    
+    if (Renderer::HasDirectStateAccess()) {
+        glNamedBufferSubData(_buffer, offset, size, data);
+    } else {
+        GLFK_AUTO_BIND_OBJ(_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    }
+    _buffer.BindRange(binding, offset, bindSize);
+    
+    return *this;
+}
+
+UniformRing& UniformRing::NextFrame()
+{
+    if (_stream) {
+        _stream->NextFrame();
+    }
+    return *this;
+}
+
+//-----------------------------------------------------
+
+BaseUniformBlock::BaseUniformBlock(Program& program, const char* blockName, GLuint binding, unsigned structSize,
+                                   const UniformBlockMember* members)
+: _index(GL_INVALID_INDEX), _binding(binding), _dataSize(0), _structSize(structSize), _valid(false)
+{
+    _index = program.GetUniformBlockIndex(blockName);
+    if (_index == GL_INVALID_INDEX) {
+        printf("Uniform block %s not found\n", blockName);
+        return;
+    }
+    program.SetUniformBlockBinding(_index, _binding);
+    _dataSize = program.GetUniformBlockInt(_index, GL_UNIFORM_BLOCK_DATA_SIZE);
+    _valid = true;
+    if (_structSize < _dataSize) {
+        // Set() would bind the whole block but copy only the struct, trailing members would read stale data
+        printf("Uniform block %s has %u bytes but the C++ struct only %u\n", blockName, _dataSize, _structSize);
+        _valid = false;
+    }
+    
+    if (!members) {
+        return;
+    }
+    for (const UniformBlockMember* m = members; m->name; ++m) {
+        // members of blocks with an instance name are prefixed with the block name
+        GLuint index = program.GetUniformIndex(m->name);
+        if (index == GL_INVALID_INDEX) {
+            std::string name = std::string(blockName) + "." + m->name;
+            index = program.GetUniformIndex(name.c_str());
+        }
+        if (index == GL_INVALID_INDEX) {
+            printf("Uniform block %s has no member %s\n", blockName, m->name);
+            _valid = false;
+            continue;
+        }
+        GLint offset = program.GetActiveUniformInt(index, GL_UNIFORM_OFFSET);
+        if (offset != (GLint)m->offset) {
+            printf("Uniform block %s member %s is at offset %u in C++ but at %d in GLSL (std140 padding?)\n",
+                   blockName, m->name, m->offset, offset);
+            _valid = false;
+        }
+        if (m->offset >= _structSize) {
+            printf("Uniform block %s member %s is outside of the struct\n", blockName, m->name);
+            _valid = false;
+        }
+    }
+}
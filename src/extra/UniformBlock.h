@@ -0,0 +1,110 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "core/Buffer.h"
+#include "core/VertexArray.h"
+#include "core/Shader.h"
+
+#include <stddef.h>
+
+/// Member of a C++ struct mirroring a std140 uniform block, arrays of members are terminated by { NULL, 0 }
+struct UniformBlockMember {
+    const char* name;
+    unsigned offset;
+};
+/// Describe a member of the struct, name of the member must match the name in the GLSL block
+#define GLFK_UNIFORM_BLOCK_MEMBER(type, member) { #member, (unsigned)offsetof(type, member) }
+
+/** Ring of uniform data slices suballocated from a single buffer
+
+Every Push() copies the data into the next slice (aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+and binds the slice using glBindBufferRange.
+With buffer storage (Renderer::HasBufferStorage) the ring is a persistently mapped StreamBuffer with one region
+per frame in flight, so a slice is one memcpy and one range bind. Call NextFrame() once per frame to fence the
+region. Otherwise slices are uploaded by glBufferSubData and the storage is orphaned when the ring wraps around,
+so the driver doesn't have to wait for draws still reading the previous data.
+*/
+class UniformRing : public NoCopy
+{
+public:
+    /// \param size Size of the ring in bytes, it should hold uniform data of at least one frame
+    /// \param regions Number of frames in flight when persistently mapped, each frame gets size bytes
+    UniformRing(unsigned size, unsigned regions = 3);
+    ~UniformRing();
+    
+    /// Copy data into a new slice and bind the slice to the uniform buffer binding point.
+    /// \param bindSize Size of the bound range, must be at least GL_UNIFORM_BLOCK_DATA_SIZE of the block (0 = size)
+    UniformRing& Push(GLuint binding, const void* data, unsigned size, unsigned bindSize = 0);
+    /// Fence slices of the frame and move to the next region of the persistent mapping, call after the draws
+    UniformRing& NextFrame();
+    
+    Buffer& GetBuffer(){ return _stream ? (Buffer&)*_stream : (Buffer&)_buffer; };
+    unsigned GetSize()const{ return _size; };
+    /// Returns true if slices are written through a persistent mapping
+    bool IsPersistent()const{ return _stream != NULL; };
+    /// Returns number of times the ring wrapped around (orphaning the buffer, or waiting for the next region)
+    unsigned GetWrapCount()const{ return _wraps; };
+    
+private:
+    /// Persistently mapped storage, NULL without buffer storage
+    StreamBuffer* _stream;
+    /// Storage updated by glBufferSubData, used without buffer storage
+    UniformBuffer _buffer;
+    unsigned _size;
+    unsigned _alignment;
+    unsigned _head;
+    unsigned _wraps;
+};
+
+/// Non-templated part of UniformBlock
+class BaseUniformBlock
+{
+public:
+    /// Returns true if the block was found and the C++ struct layout matches the GLSL block
+    bool IsValid()const{ return _valid; };
+    GLuint GetIndex()const{ return _index; };
+    GLuint GetBinding()const{ return _binding; };
+    /// Returns GL_UNIFORM_BLOCK_DATA_SIZE of the block
+    unsigned GetDataSize()const{ return _dataSize; };
+    
+protected:
+    /// Find the block in the linked program, assign it the binding point and check offsets of the members
+    BaseUniformBlock(Program& program, const char* blockName, GLuint binding, unsigned structSize,
+                     const UniformBlockMember* members);
+    
+    GLuint _index;
+    GLuint _binding;
+    unsigned _dataSize;
+    unsigned _structSize;
+    bool _valid;
+};
+
+/** Uniform block (std140 layout) mirrored by the C++ struct T
+
+The struct must follow std140 rules, e.g. vec3 members have to be padded to 16 bytes (use vec4 or add a float).
+Offsets of the described members are checked against the program reflection (GL_UNIFORM_OFFSET).
+
+Example:
+    struct PerDraw { glm::mat4 mvp; glm::vec4 color; };
+    static const UniformBlockMember perDrawMembers[] = {
+        GLFK_UNIFORM_BLOCK_MEMBER(PerDraw, mvp), GLFK_UNIFORM_BLOCK_MEMBER(PerDraw, color), { NULL, 0 } };
+    UniformBlock<PerDraw> block(prg, "PerDraw", 0, perDrawMembers);
+    ...
+    block.Set(ring, perDraw); // one memcpy and one range bind per draw
+*/
+template <typename T>
+class UniformBlock : public BaseUniformBlock
+{
+public:
+    UniformBlock(Program& program, const char* blockName, GLuint binding, const UniformBlockMember* members = NULL)
+    : BaseUniformBlock(program, blockName, binding, sizeof(T), members) {};
+    
+    /// Copy the value into the ring and bind it to the binding point of this block
+    UniformBlock& Set(UniformRing& ring, const T& value) {
+        ring.Push(_binding, &value, sizeof(T), _dataSize > sizeof(T) ? _dataSize : (unsigned)sizeof(T));
+        return *this;
+    }
+};
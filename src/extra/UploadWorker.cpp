@@ -0,0 +1,226 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#include "UploadWorker.h"
+#include "Window.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#define GL_DO_NOT_WARN_IF_MULTI_GL_VERSION_HEADERS_INCLUDED // GLAD simulates gl.h
+#include <GLFW/glfw3.h>
+
+UploadWorker::UploadWorker(Window& window)
+: _valid(false), _nextId(0), _pending(0)
+#ifdef GLFK_THREAD_SAFE_REFS
+, _context(NULL), _stop(false), _completed(NULL)
+#endif
+{
+#ifdef GLFK_THREAD_SAFE_REFS
+    // same context as extra/Window, GLFW creates windows on the main thread only
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+#ifndef WIN32
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* context = glfwCreateWindow(1, 1, "", NULL, (GLFWwindow*)window.GetNativeWindow());
+    glfwDefaultWindowHints();
+    if (!context) {
+        printf("ERR: Unable to create shared context, uploading on the calling thread\n");
+        _valid = true;
+        return;
+    }
+    _context = context;
+    _thread = std::thread(&UploadWorker::ThreadMain, this);
+#else
+    (void)window;
+#endif
+    _valid = true;
+}
+
+UploadWorker::~UploadWorker()
+{
+#ifdef GLFK_THREAD_SAFE_REFS
+    if (_context) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_one();
+        _thread.join();
+        glfwDestroyWindow((GLFWwindow*)_context);
+    }
+    DrainCompleted();
+#endif
+    for (unsigned i=0; i<_fenced.size(); i++) {
+        glDeleteSync(_fenced[i]->fence);
+        delete _fenced[i]->texture;
+        delete _fenced[i]->buffer;
+        delete _fenced[i];
+    }
+}
+
+bool UploadWorker::IsSupported()
+{
+#ifdef GLFK_THREAD_SAFE_REFS
+    return true;
+#else
+    return false;
+#endif
+}
+
+unsigned UploadWorker::UploadTexture(Texture2D& texture, GLint level, InternalFormat::E internalFormat,
+                                     GLsizei width, GLsizei height, PixelDataFormat::E format,
+                                     PixelDataType::E type, const GLvoid* data, bool mipmaps)
+{
+    Job* job = new Job;
+    job->texture = new Texture2D(texture);
+    job->level = level;
+    job->internalFormat = internalFormat;
+    job->width = width;
+    job->height = height;
+    job->format = format;
+    job->type = type;
+    job->mipmaps = mipmaps;
+    job->data = data;
+    return Queue(job);
+}
+
+unsigned UploadWorker::UploadBuffer(Buffer& buffer, GLsizeiptr size, const GLvoid* data, BufferUsage::E usage,
+                                    bool copy)
+{
+    Job* job = new Job;
+    job->buffer = new Buffer(buffer);
+    job->size = size;
+    job->usage = usage;
+    job->data = data;
+    if (copy && data) {
+        job->copy.resize(size);
+        memcpy(&job->copy[0], data, size);
+        job->data = &job->copy[0];
+    }
+    return Queue(job);
+}
+
+unsigned UploadWorker::Queue(Job* job)
+{
+    // create the object here, the worker must not create pending objects of this context (e.g. vertex arrays)
+    GLuint obj = job->texture ? (GLuint)*job->texture : (GLuint)*job->buffer;
+    (void)obj;
+
+    job->id = _nextId++;
+    _pending++;
+
+#ifdef GLFK_THREAD_SAFE_REFS
+    if (_context) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _jobs.push_back(job);
+        }
+        _wake.notify_one();
+        return job->id;
+    }
+#endif
+    Run(job);
+    _fenced.push_back(job);
+    return job->id;
+}
+
+void UploadWorker::Run(Job* job)
+{
+    if (job->texture) {
+        job->texture->SetImage(job->level, job->internalFormat, job->width, job->height, job->format, job->type,
+                               job->data);
+        if (job->mipmaps) {
+            job->texture->GenerateMipmap();
+        }
+        // a texture bound in the worker context would be kept alive after the render thread deletes it
+        job->texture->Unbind();
+    } else {
+        // copy target avoids attaching element buffers to a vertex array of this context
+        job->buffer->BaseBuffer::SetData(GL_COPY_WRITE_BUFFER, job->size, job->data, job->usage);
+        job->buffer->BaseBuffer::Unbind(GL_COPY_WRITE_BUFFER);
+    }
+
+    job->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // other contexts wait for the fence, make sure it gets to the GPU
+    glFlush();
+}
+
+#ifdef GLFK_THREAD_SAFE_REFS
+void UploadWorker::ThreadMain()
+{
+    glfwMakeContextCurrent((GLFWwindow*)_context);
+    GLStateCache::MakeCurrent(&_cache);
+
+    for (;;) {
+        Job* job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (_jobs.empty() && !_stop) {
+                _wake.wait(lock);
+            }
+            if (_jobs.empty()) {
+                break;
+            }
+            job = _jobs.front();
+            _jobs.pop_front();
+        }
+
+        // the render thread may have deleted and reused names bound here
+        _cache.Invalidate();
+        Run(job);
+        std::vector<unsigned char>().swap(job->copy);
+
+        Job* head = _completed.load(std::memory_order_relaxed);
+        do {
+            job->next = head;
+        } while (!_completed.compare_exchange_weak(head, job, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    GLStateCache::MakeCurrent(NULL);
+    glfwMakeContextCurrent(NULL);
+}
+#endif
+
+void UploadWorker::DrainCompleted()
+{
+#ifdef GLFK_THREAD_SAFE_REFS
+    Job* head = _completed.exchange(NULL, std::memory_order_acquire);
+    // the stack is newest first
+    size_t first = _fenced.size();
+    for (Job* job = head; job; job = job->next) {
+        _fenced.push_back(job);
+    }
+    std::reverse(_fenced.begin() + first, _fenced.end());
+#endif
+}
+
+bool UploadWorker::Poll(unsigned& id)
+{
+    DrainCompleted();
+
+    for (unsigned i=0; i<_fenced.size(); i++) {
+        Job* job = _fenced[i];
+        GLenum status = glClientWaitSync(job->fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            continue;
+        }
+
+        id = job->id;
+        glDeleteSync(job->fence);
+        delete job->texture;
+        delete job->buffer;
+        delete job;
+        _fenced.erase(_fenced.begin() + i);
+        _pending--;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,112 @@
+/*-
+Minimalistic and Modular OpenGL C++ Framework
+GLFK LICENSE (BSD-based) - please see LICENSE.md
+-*/
+#pragma once
+
+#include "core/Buffer.h"
+#include "core/Texture.h"
+
+#include <vector>
+
+#ifdef GLFK_THREAD_SAFE_REFS
+# include <condition_variable>
+# include <deque>
+# include <mutex>
+#endif
+
+class Window;
+
+/** Uploads texture and buffer data on a thread with a hidden context sharing objects with the window
+
+Objects are created by the calling (render) thread, only their data is specified by the worker. When an upload
+is finished the worker inserts a fence and queues the upload to a lock-free completion queue, Poll() returns it
+once the GPU passed the fence, so the object can be used by the render thread without waiting.
+Don't use the objects until Poll() returns their upload. Element array buffers uploaded by the worker must be
+attached to their vertex array by binding them on the render thread, vertex arrays aren't shared.
+
+The background thread requires GLFK_THREAD_SAFE_REFS (see IsSupported), otherwise uploads are done immediately
+by the calling thread and still reported by Poll().
+*/
+class UploadWorker : public NoCopy
+{
+public:
+    /// Create the worker context sharing objects with the window, call it on the thread of the window
+    UploadWorker(Window& window);
+    /// Finishes queued uploads, call it on the thread of the window before destroying the window
+    ~UploadWorker();
+
+    /// Returns true if uploads are done by a background thread
+    static bool IsSupported();
+    bool Valid()const{ return _valid; };
+
+    /** Queue upload of the texture image, returns id of the upload reported by Poll().
+    \param data Must stay valid until Poll() returns the upload
+    \param mipmaps Generate mipmaps after setting the image
+    */
+    unsigned UploadTexture(Texture2D& texture, GLint level, InternalFormat::E internalFormat, GLsizei width,
+                           GLsizei height, PixelDataFormat::E format, PixelDataType::E type, const GLvoid* data,
+                           bool mipmaps = false);
+    /** Queue upload of the buffer data, returns id of the upload reported by Poll().
+    \param data Must stay valid until Poll() returns the upload, unless copy is true
+    */
+    unsigned UploadBuffer(Buffer& buffer, GLsizeiptr size, const GLvoid* data,
+                          BufferUsage::E usage = BufferUsage::STATIC_DRAW, bool copy = false);
+
+    /// Returns id of an upload which the GPU finished, false if none. Doesn't block, call it on the render thread.
+    bool Poll(unsigned& id);
+    /// Returns number of uploads not returned by Poll() yet
+    unsigned GetPendingCount()const{ return _pending; };
+
+private:
+    struct Job {
+        Job() : texture(NULL), buffer(NULL), fence(NULL), next(NULL) {};
+
+        unsigned id;
+        /// Copies of the wrappers, released by the render thread in Poll()
+        Texture2D* texture;
+        Buffer* buffer;
+        GLint level;
+        InternalFormat::E internalFormat;
+        GLsizei width;
+        GLsizei height;
+        PixelDataFormat::E format;
+        PixelDataType::E type;
+        bool mipmaps;
+        GLsizeiptr size;
+        BufferUsage::E usage;
+        const GLvoid* data;
+        std::vector<unsigned char> copy;
+
+        /// Inserted after the upload by the context which did it
+        GLsync fence;
+        /// Link in the completion queue
+        Job* next;
+    };
+
+    unsigned Queue(Job* job);
+    /// Upload data of the job and insert its fence, on the thread of the context doing the upload
+    static void Run(Job* job);
+    /// Move uploads completed by the worker to the fenced list, in order of completion
+    void DrainCompleted();
+
+    bool _valid;
+    unsigned _nextId;
+    unsigned _pending;
+    /// Completed uploads waiting for their fence, used by the render thread only
+    std::vector<Job*> _fenced;
+
+#ifdef GLFK_THREAD_SAFE_REFS
+    void ThreadMain();
+
+    void* _context;
+    GLStateCache _cache;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<Job*> _jobs;
+    bool _stop;
+    /// Lock-free stack of completed uploads, pushed by the worker and taken at once by the render thread
+    std::atomic<Job*> _completed;
+#endif
+};
@@ -3,6 +3,9 @@ Minimalistic and Modular OpenGL C++ Framework
 GLFK LICENSE (BSD-based) - please see LICENSE.md
 -*/
 
+class GLStateCache;
+class FramePacer;
+
 class Window
 {
     typedef void(*FramebufferSizeCallback) (unsigned width, unsigned height);
@@ -22,7 +25,15 @@ public:
     */
     bool Create(unsigned width, unsigned height, const char* title, bool srgb = true);
     bool Valid()const{ return _valid; };
+    /// Make the window context current on the calling thread together with its GLStateCache
+    Window& MakeCurrent();
+    /// Returns the binding cache of this window's context
+    GLStateCache& GetStateCache();
+    /// Returns the GLFWwindow, e.g. to create contexts sharing objects with this one
+    void* GetNativeWindow();
     Window& SwapBuffers();
+    /// Limit frames in flight by the pacer after every SwapBuffers(), NULL disables it. Returns the previous pacer.
+    FramePacer* SetFramePacer(FramePacer* pacer);
     Window& PollEvents();
     Window& GetFramebufferSize(int& width, int& height);
     bool ShouldClose();
@@ -3,6 +3,9 @@ Minimalistic and Modular OpenGL C++ Framework
 GLFK LICENSE (BSD-based) - please see LICENSE.md
 -*/
 #include "extra/Window.h"
+#include "core/Renderer.h"
+#include "extra/Shaders.h"
+#include "extra/FramePacer.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -63,11 +66,14 @@ void Window::EnableDebugLog(bool enable)
 struct Window::sPrivate {
     sPrivate() 
     :	window(NULL),
+        framePacer(NULL),
         framebufferSizeCallback(NULL),
         keyCallback(NULL)
     {}
 
     GLFWwindow* window;
+    GLStateCache stateCache;
+    FramePacer* framePacer;
 
     Window::FramebufferSizeCallback framebufferSizeCallback;
     static void _FramebufferSizeCallback(GLFWwindow *w, int width, int height) 
@@ -108,6 +114,19 @@ Window::Window(unsigned width, unsigned height, const char* title, bool srgb)
 
 Window::~Window() 
 {
+    if (_private->window) {
+        // shared shaders and programs of the context must go while it exists
+        MakeCurrent();
+        ShaderRegistry::Release(&_private->stateCache);
+        GLObject::ReleasePending();
+        _private->stateCache.GetReleaseQueue().Drain();
+        _private->stateCache.GetDeleteQueue().Finish();
+        _private->stateCache.GetNamePool().Clear();
+    }
+    if (&GLStateCache::Current() == &_private->stateCache) {
+        GLStateCache::MakeCurrent(NULL);
+    }
+    
     glfwTerminate();
 
     delete _private;
@@ -139,7 +158,7 @@ bool Window::Create(unsigned width, unsigned height, const char* title, bool srg
     }
 
     glfwSetWindowUserPointer(_private->window, _private);
-    glfwMakeContextCurrent(_private->window);
+    MakeCurrent();
 	
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
 
@@ -147,9 +166,14 @@ bool Window::Create(unsigned width, unsigned height, const char* title, bool srg
         printf("ERR: Your system doesn't support OpenGL >= 3.2!\n");
         return false;
     }
+    
+    Renderer::DetectFeatures();
 
     printf("OpenGL Version: %s\n", glGetString(GL_VERSION));
     printf("GLSL Version: %s\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
+    printf("Direct State Access: %s\n", Renderer::HasDirectStateAccess() ? "yes" : "no");
+    printf("Buffer Storage: %s\n", Renderer::HasBufferStorage() ? "yes" : "no");
+    printf("Separate Shader Objects: %s\n", Renderer::HasSeparateShaderObjects() ? "yes" : "no");
 
     GLint n, i;
     glGetIntegerv(GL_NUM_EXTENSIONS, &n);
@@ -204,11 +228,40 @@ Window::KeyCallback Window::SetKeyCallback(KeyCallback cb)
     return prev;
 }
 
+Window& Window::MakeCurrent()
+{
+    glfwMakeContextCurrent(_private->window);
+    GLStateCache::MakeCurrent(&_private->stateCache);
+    return *this;
+}
+GLStateCache& Window::GetStateCache()
+{
+    return _private->stateCache;
+}
+void* Window::GetNativeWindow()
+{
+    return _private->window;
+}
+
 Window& Window::SwapBuffers()
 {
+    // objects released by other threads and names released during the frame are deleted once the GPU finishes it
+    _private->stateCache.GetReleaseQueue().Drain();
+    // objects released by other threads while no context owned them
+    GLStateCache::GetDefault().GetReleaseQueue().Drain();
+    _private->stateCache.GetDeleteQueue().EndFrame();
     glfwSwapBuffers(_private->window);
+    if (_private->framePacer) {
+        _private->framePacer->EndFrame();
+    }
     return *this;
 }
+FramePacer* Window::SetFramePacer(FramePacer* pacer)
+{
+    FramePacer* prev = _private->framePacer;
+    _private->framePacer = pacer;
+    return prev;
+}
 Window& Window::PollEvents()
 {
     glfwPollEvents();